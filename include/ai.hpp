@@ -3,8 +3,10 @@
 
 #include <string>
 #include "config.hpp"
+#include "provider.hpp"
 #include "json.hpp"
 #include <vector> //Include vector
+#include <functional>
 
 namespace AI {
 
@@ -18,12 +20,41 @@ struct PackageListResponse {
     std::vector<PackageInfo> packages;
 };
 
-PackageListResponse queryPackageList(const Config &config, const nlohmann::json &sysInfo, const std::string &userQuery, const std::string &apiKey);
+// The single-query prompt: static instructions plus the user's turn, which
+// carries the system description and any probed context.
+CompletionRequest packageListRequest(const Config &config, const std::string &userQuery, const nlohmann::json &context = nlohmann::json::object());
+
+// Extracts the package list from the model's reply text.
+PackageListResponse parsePackageList(const std::string &jsonText);
+
+// One-line description of the user's environment, used in prompts.
+std::string describeSystem(const Config &config);
+
+// Opens the connection to the first tier's endpoint (DNS, TCP, TLS) ahead of
+// the first query. Safe to call from a background thread.
+void preconnect(const Config &config);
+
+// True if some tier routes to a Gemini provider that relies on GEMINI_API_KEY.
+bool requiresGeminiKey(const Config &config);
+
+// Returns true if a suggested package name exists in the package repositories.
+using PackageValidator = std::function<bool(const std::string &packageName)>;
+
+// Asks each tier of config.models in turn, through the configured provider, escalating to the next tier only
+// when the answer has no usable packages or the validator rejects one of them.
+// Per-tier latency and escalations are recorded in the cache's tiers.json.
+PackageListResponse queryPackageList(const Config &config, const nlohmann::json &sysInfo, const std::string &userQuery, const std::string &apiKey, const PackageValidator &validator = nullptr);
+
+// Same ladder walk for a prepared request (e.g. a multi-turn conversation);
+// request.model is filled in per tier.
+PackageListResponse queryPackageList(const Config &config, CompletionRequest request, const std::string &apiKey, const PackageValidator &validator = nullptr);
+
+// Serializes a response as {"packages": [{"package_name": ..., "command": ...}]}.
+nlohmann::json toJson(const PackageListResponse &response);
 
 //JSON conversion helper function:
 template <typename T>
 T from_json(const nlohmann::json& j);
-template <typename T>
 nlohmann::json safe_parse(const std::string& str);
 
 } // namespace AI
@@ -0,0 +1,20 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include "ai.hpp"
+#include "config.hpp"
+#include <string>
+#include <vector>
+
+namespace AI {
+
+// Answers many queries with as few API calls as possible: queries are packed
+// with ids into one prompt, the keyed reply is split back into one response
+// per query (same order as queries). The batch size adapts to observed
+// latency and output token use; queries a batch drops are retried in a
+// smaller batch and finally through queryPackageList.
+std::vector<PackageListResponse> queryPackageLists(const Config &config, const std::vector<std::string> &queries, const std::string &apiKey);
+
+} // namespace AI
+
+#endif // BATCH_HPP
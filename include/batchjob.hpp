@@ -0,0 +1,26 @@
+#ifndef BATCHJOB_HPP
+#define BATCHJOB_HPP
+
+#include "config.hpp"
+#include <string>
+
+namespace AI {
+
+struct BatchJobOptions {
+    std::string corpus_path;  // one query per line
+    std::string output_path;  // JSON lines, appended to
+    std::string state_path;   // local job state, used to resume
+    double initial_poll_seconds = 10.0;
+    double max_poll_seconds = 300.0;
+};
+
+// Runs a corpus through the Gemini Batch API: submits it as one job (or
+// resumes the job recorded in the state file), polls with exponential
+// backoff, and appends one {"id", "query", "packages"} line per query to the
+// output. Lines already present in the output are not written twice, so an
+// interrupted run can simply be restarted. Returns false on failure.
+bool runBatchJob(const Config &config, const BatchJobOptions &options, const std::string &apiKey);
+
+} // namespace AI
+
+#endif // BATCHJOB_HPP
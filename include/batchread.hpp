@@ -0,0 +1,25 @@
+#ifndef BATCHREAD_HPP
+#define BATCHREAD_HPP
+
+#include <string>
+#include <vector>
+
+// Reads many small files at once. Directory trees such as the pacman local
+// database are thousands of tiny files, so the cost is syscall round trips
+// and (on a cold cache) I/O latency, not bandwidth.
+namespace BatchRead {
+
+enum class Method {
+    Auto,     // io_uring when the kernel allows it, otherwise threads
+    IoUring,  // openat/read/close submitted in batches through one ring
+    Threads   // plain open/read/close spread over a few threads
+};
+
+// Returns the contents of each path, in order; unreadable files give "".
+// If used is non-null it is set to the method that actually ran.
+std::vector<std::string> readFiles(const std::vector<std::string> &paths, Method method = Method::Auto,
+                                   Method *used = nullptr);
+
+} // namespace BatchRead
+
+#endif // BATCHREAD_HPP
@@ -0,0 +1,33 @@
+#ifndef BUILTINS_HPP
+#define BUILTINS_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Native answers for common informational queries. These run in-process
+// (getifaddrs, statvfs, procfs) with no API call and no child process.
+namespace Builtins {
+
+struct Handler {
+    std::string name;
+    // Phrases that ask for exactly this report ("disk usage", "my ip"); one
+    // must appear in the query as consecutive words.
+    std::vector<std::string> phrases;
+    // Words that match on their own only when the query is nothing else
+    // ("disk", "show my ip"), after filler words are dropped.
+    std::vector<std::string> keywords;
+    // Words that mean the query is about something this handler can't answer.
+    std::vector<std::string> exclusions;
+    std::function<std::string()> run;
+};
+
+const std::vector<Handler> &registry();
+
+// Returns the best matching handler for the query, or nullptr if the query
+// should go to the AI.
+const Handler *match(const std::string &query);
+
+} // namespace Builtins
+
+#endif // BUILTINS_HPP
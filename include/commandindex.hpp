@@ -0,0 +1,39 @@
+#ifndef COMMANDINDEX_HPP
+#define COMMANDINDEX_HPP
+
+#include "config.hpp"
+#include "stringtable.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Packages {
+
+// Maps executable basenames (anything installed under a bin or sbin
+// directory) to the installed packages that own them. Built from pacman's
+// local/<pkg>/files lists or dpkg's info/*.list files, stored as a mapped
+// string table and rebuilt when packages are installed or removed.
+class CommandIndex {
+public:
+    static CommandIndex open(const Config &config);
+
+    // Either root may be empty; the other is then the only source.
+    static CommandIndex open(const std::string &pacmanLocalDb, const std::string &dpkgInfoDir, const std::string &indexPath);
+
+    bool empty() const { return table.empty(); }
+
+    // Installed packages shipping an executable with this name.
+    std::vector<std::string> owners(std::string_view command) const;
+
+private:
+    StringTable table; // command -> package, one entry per owner
+};
+
+// The program a shell command line runs first: "sudo", "env" and variable
+// assignments are skipped and any directory is dropped, so
+// "sudo FOO=1 /usr/bin/lsusb -v" gives "lsusb".
+std::string commandProgram(const std::string &command);
+
+} // namespace Packages
+
+#endif // COMMANDINDEX_HPP
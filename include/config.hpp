@@ -2,10 +2,22 @@
 #define CONFIG_HPP
 
 #include "json.hpp"  // nlohmann/json single-header library
+#include <map>
+#include <optional>
 #include <string>
+#include <vector>
 
 using json = nlohmann::json;
 
+// An AI backend endpoint. type is "gemini", "openai" (any OpenAI-compatible
+// server, e.g. vLLM or Ollama) or "llama" (a local llama.cpp server, which also
+// gets grammar-constrained decoding and prompt caching).
+struct ProviderSettings {
+    std::string type;
+    std::string base_url;
+    std::string api_key_env; // environment variable holding the key; may be empty
+};
+
 class Config {
 public:
     std::string distro;
@@ -14,6 +26,33 @@ public:
     std::string terminal;
     std::string package_manager;
 
+    // Model ladder, fastest first. Later tiers are only asked when an earlier
+    // answer fails validation. An entry is "model" (default provider) or
+    // "provider:model"; alternatives separated by '|' share a tier and the one
+    // with the lowest measured median latency is used.
+    std::vector<std::string> models = {"gemini-2.0-flash-lite", "gemini-2.0-flash"};
+
+    // Named AI backends and the one used for entries without a provider prefix.
+    std::map<std::string, ProviderSettings> providers = {
+        {"gemini", {"gemini", "https://generativelanguage.googleapis.com/", ""}}
+    };
+    std::string provider = "gemini";
+
+    // Approximate token cap on the history a --session conversation resends.
+    int session_token_budget = 4000;
+
+    // Bandwidth (KiB/s) for downloading suggested packages in the background
+    // while the menu is open; 0 turns this prefetching off.
+    int prefetch_rate_kib = 2048;
+
+    // Replace sysiq with the chosen command when it is the only thing left to
+    // do, freeing its memory; no exit status or timing summary is shown then.
+    bool exec_in_place = false;
+
+    // Reads the configuration file without prompting or printing; nullopt if
+    // it is missing or invalid (the reason goes to *error when given).
+    static std::optional<Config> read(const std::string &configPath, std::string *error = nullptr);
+
     // Loads configuration from file; if missing, launches interactive setup.
     static Config load(const std::string &configPath = "/home/xyz/.config/sysiq/config.json");
 
@@ -0,0 +1,29 @@
+#ifndef DISPLAY_HPP
+#define DISPLAY_HPP
+
+#include "json.hpp"
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+// A connected output as reported by the kernel DRM subsystem.
+struct MonitorInfo {
+    std::string connector;     // e.g. "card0-HDMI-A-1"
+    std::string name;          // EDID monitor name descriptor, if present
+    std::string manufacturer;  // three-letter EDID PNP id
+    int width = 0;
+    int height = 0;
+    double refresh_hz = 0.0;
+};
+
+// Reads /sys/class/drm/*/{status,modes,edid} directly; no xrandr, no X server.
+std::vector<MonitorInfo> probeMonitors(const std::string &drmRoot = "/sys/class/drm");
+
+// Parses a raw EDID blob into the name/manufacturer/preferred timing fields.
+// Returns false if the blob is not a valid EDID base block.
+bool parseEdid(const std::string &edid, MonitorInfo &monitor);
+
+json toJson(const MonitorInfo &monitor);
+
+#endif // DISPLAY_HPP
@@ -0,0 +1,27 @@
+#ifndef DPKGSTATUS_HPP
+#define DPKGSTATUS_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Packages {
+
+const char *const kDpkgStatus = "/var/lib/dpkg/status";
+
+struct DpkgStatus {
+    std::vector<std::string> installed; // one entry per installed stanza (per architecture)
+    std::vector<std::string> provides;  // virtual packages provided by them
+};
+
+// Parses dpkg's status database. Only the Package, Status and Provides lines
+// are looked at; everything else is skipped with a vectorized scan. With
+// installedOnly false every stanza counts, which suits apt's Packages lists.
+DpkgStatus parseDpkgStatus(const char *data, size_t size, bool installedOnly = true);
+
+// Maps the status file and parses it; empty if it cannot be read.
+DpkgStatus loadDpkgStatus(const std::string &path = kDpkgStatus);
+
+} // namespace Packages
+
+#endif // DPKGSTATUS_HPP
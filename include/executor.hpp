@@ -0,0 +1,44 @@
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fixed-size thread pool used to run independent startup stages
+// (preconnect, probes, package loading) concurrently.
+class Executor {
+public:
+    explicit Executor(unsigned threads = 4);
+    ~Executor(); // Finishes queued tasks, then joins the workers.
+
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    // Queues a task and returns a future for its result.
+    template <typename F>
+    auto submit(F &&task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> result = packaged->get_future();
+        post([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+private:
+    void post(std::function<void()> job);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool stopping = false;
+};
+
+#endif // EXECUTOR_HPP
@@ -0,0 +1,65 @@
+#ifndef HTTP_HPP
+#define HTTP_HPP
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Http {
+
+struct Request {
+    std::string method = "POST";
+    std::string url;
+    std::vector<std::string> headers;
+    std::string body;
+    long timeout_seconds = 60;
+};
+
+struct Response {
+    long status = 0;       // HTTP status, 0 if the transfer itself failed
+    std::string body;
+    std::string error;     // transport error message, empty on success
+};
+
+// Abstract HTTP client so the rest of the program never touches libcurl.
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    virtual Response perform(const Request &request) = 0;
+
+    // Opens (DNS, TCP, TLS) a connection to the host of url for later reuse.
+    virtual void preconnect(const std::string &url) = 0;
+};
+
+// While alive, requests made on this thread fail with error "cancelled"
+// (within about a second) once flag is set, including one already in
+// progress. Scopes nest; the innermost flag applies.
+class CancelScope {
+public:
+    explicit CancelScope(const std::atomic<bool> &flag);
+    ~CancelScope();
+
+    CancelScope(const CancelScope &) = delete;
+    CancelScope &operator=(const CancelScope &) = delete;
+
+    // The current thread's flag, or nullptr outside any scope.
+    static const std::atomic<bool> *current();
+
+private:
+    const std::atomic<bool> *previous;
+};
+
+// Process-wide transport. libcurl (and its TLS stack) is dlopen'd the first
+// time a request is made, so runs that never touch the network never load it.
+Transport &transport();
+
+// Loads libcurl now; returns false if the library could not be found.
+bool loadNetwork();
+
+// True once libcurl has been loaded into the process.
+bool networkLoaded();
+
+} // namespace Http
+
+#endif // HTTP_HPP
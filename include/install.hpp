@@ -0,0 +1,60 @@
+#ifndef INSTALL_HPP
+#define INSTALL_HPP
+
+#include "config.hpp"
+#include "process.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Packages {
+
+struct InstallProgress {
+    std::string stage;   // "downloading", "installing", ...
+    double fraction = 0; // overall progress of the transaction, 0..1
+    std::string line;    // the output line it was parsed from
+};
+
+struct InstallResult {
+    int exit_code = -1;
+    std::vector<std::string> installed; // requested packages present afterwards
+    std::vector<std::string> failed;    // requested packages still missing
+    std::vector<std::string> output;    // last lines of the manager's output
+};
+
+// The command installing all packages in one non-interactive transaction,
+// with parallel downloads enabled.
+std::vector<std::string> installCommand(const Config &config, const std::vector<std::string> &packages);
+
+// Installs packages in a single transaction. The package manager runs on a
+// pty and its progress output is parsed and passed to onProgress. Success
+// is judged per package by checking what is installed afterwards, not only
+// by the exit code.
+InstallResult install(const Config &config, const std::vector<std::string> &packages,
+                      const std::function<void(const InstallProgress &)> &onProgress);
+
+// Speculatively downloads packages into the package manager's cache
+// (pacman -Sw, apt-get --download-only) at config.prefetch_rate_kib while the
+// user is still choosing, so an install afterwards only has to unpack. Partial
+// downloads are kept, so cancelling and then installing resumes them. Does
+// nothing unless it can run without a password prompt (root or cached sudo).
+class Prefetch {
+public:
+    Prefetch(const Config &config, const std::vector<std::string> &packages);
+
+    // Stops downloading; must happen before an install takes the package
+    // manager's lock. The destructor cancels too.
+    void cancel() { if (download) download->cancel(); }
+
+private:
+    std::unique_ptr<Process::Background> download;
+};
+
+// Parses one progress line from pacman or apt (Status-Fd) output; false if the
+// line carries no progress.
+bool parseInstallProgress(const std::string &line, InstallProgress &progress);
+
+} // namespace Packages
+
+#endif // INSTALL_HPP
@@ -0,0 +1,25 @@
+#ifndef JSONREPAIR_HPP
+#define JSONREPAIR_HPP
+
+#include "json.hpp"
+#include <string>
+
+using json = nlohmann::json;
+
+// Best-effort recovery of the JSON a model meant to send.
+namespace JsonRepair {
+
+// Rewrites text into parseable JSON where possible: strips markdown code
+// fences and leading prose, drops trailing commas, inserts missing commas
+// between adjacent values, escapes raw control characters inside strings,
+// and cuts a truncated document back to its last complete value before
+// closing any open brackets.
+std::string repair(const std::string &text);
+
+// Parses text strictly, falling back to repair(). Returns a discarded value
+// (is_discarded() == true) if neither succeeds.
+json parse(const std::string &text);
+
+} // namespace JsonRepair
+
+#endif // JSONREPAIR_HPP
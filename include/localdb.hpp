@@ -0,0 +1,46 @@
+#ifndef LOCALDB_HPP
+#define LOCALDB_HPP
+
+#include "batchread.hpp"
+#include <string>
+#include <vector>
+
+namespace Packages {
+
+const char *const kPacmanLocalDb = "/var/lib/pacman/local";
+
+struct LocalPackage {
+    std::string name;
+    std::string version;
+    std::vector<std::string> provides; // bare names, version constraints dropped
+};
+
+// In-memory index of pacman's local database, built by reading every
+// <dbRoot>/<pkg>-<ver>/desc file directly instead of asking pacman.
+class LocalIndex {
+public:
+    static LocalIndex load(const std::string &dbRoot = kPacmanLocalDb,
+                           BatchRead::Method method = BatchRead::Method::Auto);
+
+    bool empty() const { return packages.empty(); }
+
+    // Exact package name lookup; nullptr if not installed.
+    const LocalPackage *find(const std::string &name) const;
+
+    // True if an installed package has this name or provides it.
+    bool provides(const std::string &name) const;
+
+    std::vector<LocalPackage> packages;                    // sorted by name
+    std::vector<std::pair<std::string, size_t>> provided;  // provided name -> package, sorted
+};
+
+// Parses one desc file; returns a package with an empty name on bad input.
+LocalPackage parseDesc(const std::string &desc);
+
+// Times building the index with a cold and a warm page cache, through
+// io_uring and through threads, against spawning "pacman -Qi" per package.
+int benchmarkLocalIndex(const std::string &dbRoot = kPacmanLocalDb);
+
+} // namespace Packages
+
+#endif // LOCALDB_HPP
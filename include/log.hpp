@@ -0,0 +1,67 @@
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include "json.hpp"
+#include <string>
+#include <vector>
+
+// Diagnostics (requests, raw responses, timings) written to a log file
+// instead of the terminal. Records are queued on a lock-free ring and
+// formatted and written as JSON lines by a background thread, so logging
+// costs the caller little more than moving its fields.
+//
+//   LOG_DEBUG("http request", {"url", url}, {"bytes", body.size()});
+//
+// The file is $XDG_CACHE_HOME/sysiq/sysiq.log (see cachePath) and the level
+// comes from $SYSIQ_LOG (trace, debug, info, warn, error or off; default
+// info). Registered secrets, key/token query parameters, Authorization-style
+// headers and fields whose name mentions a key, token, secret or password are
+// redacted before anything is written.
+namespace Log {
+
+enum class Level { Trace = 0, Debug, Info, Warn, Error, Off };
+
+// Records below this level are compiled out, arguments included. Build with
+// -DSYSIQ_LOG_COMPILED_LEVEL=0 to keep trace records (full payloads).
+#ifndef SYSIQ_LOG_COMPILED_LEVEL
+#define SYSIQ_LOG_COMPILED_LEVEL 1
+#endif
+
+struct Field {
+    const char *key;
+    nlohmann::json value;
+};
+
+// Whether records at level are currently written.
+bool enabled(Level level);
+void setLevel(Level level);
+
+// Writes to path instead of the default file; call before the first record.
+void setFile(const std::string &path);
+
+// Values (API keys) to replace with "[redacted]" wherever they appear.
+void addSecret(const std::string &secret);
+
+// Queues a record; message must be a string literal. Dropped (and counted)
+// when the ring is full.
+void write(Level level, const char *message, std::vector<Field> fields = {});
+
+// Waits until everything queued so far is in the file.
+void flush();
+
+} // namespace Log
+
+#define SYSIQ_LOG(level, ...)                                                      \
+    do {                                                                           \
+        if constexpr (static_cast<int>(level) >= SYSIQ_LOG_COMPILED_LEVEL) {       \
+            if (::Log::enabled(level)) ::Log::write(level, __VA_ARGS__);           \
+        }                                                                          \
+    } while (0)
+
+#define LOG_TRACE(message, ...) SYSIQ_LOG(::Log::Level::Trace, message, {__VA_ARGS__})
+#define LOG_DEBUG(message, ...) SYSIQ_LOG(::Log::Level::Debug, message, {__VA_ARGS__})
+#define LOG_INFO(message, ...) SYSIQ_LOG(::Log::Level::Info, message, {__VA_ARGS__})
+#define LOG_WARN(message, ...) SYSIQ_LOG(::Log::Level::Warn, message, {__VA_ARGS__})
+#define LOG_ERROR(message, ...) SYSIQ_LOG(::Log::Level::Error, message, {__VA_ARGS__})
+
+#endif // LOG_HPP
@@ -0,0 +1,29 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include "json.hpp"
+#include <string>
+#include <vector>
+
+// Machine-readable results (--output) for wrappers and scripts: the same
+// documents as JSON text or as CBOR / MessagePack bytes, written to stdout
+// with no prompts, colors or progress.
+namespace Output {
+
+enum class Format { Text, Json, JsonLines, Cbor, MessagePack };
+
+// "json", "jsonl", "cbor" or "msgpack"; false for anything else.
+bool parseFormat(const std::string &name, Format &format);
+
+// Writes one document: pretty-printed JSON, one JSON line, or one CBOR /
+// MessagePack item. Binary items are self-delimiting, so several written in a
+// row form a stream (an RFC 8742 CBOR sequence, a MessagePack stream).
+void write(Format format, const nlohmann::json &document);
+
+// Writes a list of documents: a single array for json, otherwise one item
+// per document.
+void writeAll(Format format, const std::vector<nlohmann::json> &documents);
+
+} // namespace Output
+
+#endif // OUTPUT_HPP
@@ -0,0 +1,50 @@
+#ifndef OUTPUTCACHE_HPP
+#define OUTPUTCACHE_HPP
+
+#include "preview.hpp"
+#include <map>
+#include <string>
+
+namespace Preview {
+
+// Outputs of read-only commands from earlier runs, so asking the same
+// question again within minutes prints at once. An entry is keyed by the
+// command and the environment that shapes its output (locale, PATH, working
+// directory, user) and is valid for a per-program time, and only while the
+// state it reports on (network addresses, mounts, installed packages,
+// attached devices, the boot) is unchanged.
+class OutputCache {
+public:
+    struct Entry {
+        std::string command;
+        std::string output;
+        long stored_at = 0; // seconds since the epoch
+        std::string state;  // fingerprint of what the output depends on
+    };
+
+    static OutputCache load(const std::string &path);
+    void save(const std::string &path) const;
+
+    // An earlier output of command that is still valid, or nullptr.
+    const Entry *find(const std::string &command) const;
+
+    // Keeps the output of a complete, successful run when command is
+    // cacheable; returns whether it was kept.
+    bool store(const std::string &command, const Result &result);
+
+    std::map<std::string, Entry> entries;
+};
+
+// How long the output of command stays valid, in seconds; 0 when it changes
+// too often to be worth caching or command is not read-only. A pipeline gets
+// the shortest time of its stages.
+long ttlSeconds(const std::string &command);
+
+// Hash of the interfaces (names, hardware addresses, flags), their IP
+// addresses and the main routing table, from a netlink dump. "" when netlink
+// is unavailable.
+std::string networkFingerprint();
+
+} // namespace Preview
+
+#endif // OUTPUTCACHE_HPP
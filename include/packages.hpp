@@ -0,0 +1,34 @@
+#ifndef PACKAGES_HPP
+#define PACKAGES_HPP
+
+#include "config.hpp"
+#include "syncindex.hpp"
+#include <string>
+#include <unordered_set>
+
+namespace Packages {
+
+using InstalledSet = std::unordered_set<std::string>;
+
+// Loads the names of all installed packages with a single package manager
+// query. Returns an empty set if the package manager could not be queried.
+InstalledSet loadInstalled(const Config &config);
+
+// Checks the preloaded set first and only spawns the package manager when no
+// set is available.
+bool isInstalled(const std::string &package, const Config &config, const InstalledSet &installed);
+
+// Whether the package is installed or in the repositories under this name or
+// one that differs only in case, '_' or '.' (see SyncIndex::spelling). Never
+// corrects a typo, so a misspelled suggestion fails validation.
+bool exists(const std::string &package, const Config &config, const InstalledSet &installed, const SyncIndex &sync);
+
+// The name under which a suggested package is installed or available: the
+// name itself, the nearest repository name if it looks misspelled, or "" if
+// it is unknown. Without a sync index the package manager is asked instead;
+// unknown package managers are given the benefit of the doubt.
+std::string resolve(const std::string &package, const Config &config, const InstalledSet &installed, const SyncIndex &sync);
+
+} // namespace Packages
+
+#endif // PACKAGES_HPP
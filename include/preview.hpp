@@ -0,0 +1,64 @@
+#ifndef PREVIEW_HPP
+#define PREVIEW_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <future>
+#include <string>
+#include <vector>
+
+// Runs side-effect-free suggestions ahead of time, while the menu is shown,
+// so their output is ready the moment one is chosen.
+namespace Preview {
+
+// Conservative check that a shell command only reads: every stage of a
+// pipeline or && chain must be a known informational program (with its
+// subcommand, for tools like ip or systemctl), and there must be no output
+// redirection, command substitution or privilege escalation.
+bool isReadOnly(const std::string &command);
+
+// Read-only and its output would not be changed by the sandbox (for root,
+// tools that list mounts would show the sandbox's own /dev, and tools that
+// rely on root's capabilities, like ss -p or dmesg, would see less).
+bool canPreview(const std::string &command);
+
+// Program names of each stage of a command line, paths stripped.
+std::vector<std::string> programs(const std::string &command);
+
+struct Limits {
+    int timeout_ms = 5000;
+    size_t max_output = 64 * 1024;
+    int cpu_seconds = 5;
+    size_t memory_bytes = size_t(1) << 30;
+};
+
+struct Result {
+    bool sandboxed = false; // the sandbox could be set up and the command ran
+    bool complete = false;  // it exited on its own within the limits
+    int exit_code = -1;
+    std::string output;     // stdout and stderr, interleaved, as written to a terminal
+};
+
+// One command running in the background under /bin/sh inside a sandbox: new
+// user and mount namespaces with every mount read-only (and, for root, a
+// minimal /dev), a seccomp filter against ptrace, signals, mounts, module
+// loading, Unix sockets (so no daemon acts for it) and the like, and CPU,
+// memory, wall-clock and output limits.
+class Run {
+public:
+    explicit Run(const std::string &command, const Limits &limits = {});
+    ~Run(); // cancels and reaps
+    Run(const Run &) = delete;
+    Run &operator=(const Run &) = delete;
+
+    void cancel() { cancelled = true; }
+    Result wait() { return result.get(); }
+
+private:
+    std::atomic<bool> cancelled{false};
+    std::shared_future<Result> result;
+};
+
+} // namespace Preview
+
+#endif // PREVIEW_HPP
@@ -0,0 +1,89 @@
+#ifndef PROCESS_HPP
+#define PROCESS_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace Process {
+
+// Runs argv (searched in PATH) with stdin, stdout and stderr on a new
+// pseudo-terminal, so tools that only draw progress for a terminal still do.
+// onOutput receives the output as it arrives, in arbitrary chunks. Returns the
+// exit status, 128 + signal if it was killed, or -1 if it could not start.
+int runInPty(const std::vector<std::string> &argv, const std::function<void(const std::string &)> &onOutput);
+
+// Runs argv (searched in PATH) without a shell, so arguments are never
+// interpreted, and waits for it. stdin and stderr are /dev/null; stdout is
+// collected into *output when given and discarded otherwise. Returns the exit
+// status as for runInPty.
+int run(const std::vector<std::string> &argv, std::string *output = nullptr);
+
+// Exit status and resource use of a finished command, from wait4(2).
+struct Usage {
+    int exit_code = -1;     // as for runInPty
+    double wall_ms = 0;
+    double user_ms = 0;     // CPU time of the command and the children it waited for
+    double system_ms = 0;
+    long peak_rss_kib = 0;  // largest resident set among them
+};
+
+// Runs argv on a pseudo-terminal attached to ours: keystrokes are passed
+// through (with our terminal in raw mode meanwhile, so Ctrl-C reaches the
+// command, not sysiq), window size changes follow, and output is written to
+// stdout as it arrives and also given to onOutput.
+Usage runAttached(const std::vector<std::string> &argv, const std::function<void(const std::string &)> &onOutput = nullptr);
+
+// argv running command with the configured shell, given as a name or path
+// ("zsh", "/usr/bin/fish"); $SHELL and then /bin/sh when it can't be found.
+std::vector<std::string> shellCommand(const std::string &configuredShell, const std::string &command);
+
+// Replaces this process with argv; only returns if that fails.
+void execInPlace(const std::vector<std::string> &argv);
+
+// Splits a stream of output chunks into lines, treating '\r' (progress bar
+// redraws) like '\n'; empty lines are dropped.
+class LineSplitter {
+public:
+    explicit LineSplitter(std::function<void(const std::string &)> onLine) : onLine(std::move(onLine)) {}
+    void feed(const std::string &chunk);
+    void finish(); // flushes a trailing unterminated line
+
+private:
+    std::function<void(const std::string &)> onLine;
+    std::string pending;
+};
+
+// Process groups to take down if sysiq is interrupted, for children that run
+// in their own group (and so don't get the terminal's Ctrl-C) and would
+// otherwise outlive it. killTrackedOnSignal() installs SIGINT, SIGTERM and
+// SIGHUP handlers that send each tracked group its signal and then let the
+// interruption take its normal course. Async-signal-safe.
+void trackGroup(pid_t group, int signal);
+void untrackGroup(pid_t group);
+void killTrackedOnSignal();
+
+// A child process running in the background in its own process group with
+// its output discarded, at lowered CPU and I/O priority. Terminated (with
+// everything it started) when cancelled or destroyed, or when sysiq is
+// interrupted (see killTrackedOnSignal).
+class Background {
+public:
+    explicit Background(const std::vector<std::string> &argv);
+    ~Background() { cancel(); }
+    Background(const Background &) = delete;
+    Background &operator=(const Background &) = delete;
+
+    bool running();
+    void cancel();
+    int wait(); // exit status as for runInPty
+
+private:
+    pid_t pid = -1;
+    int status = -1;
+};
+
+} // namespace Process
+
+#endif // PROCESS_HPP
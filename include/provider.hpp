@@ -0,0 +1,87 @@
+#ifndef PROVIDER_HPP
+#define PROVIDER_HPP
+
+#include "config.hpp"
+#include "json.hpp"
+#include "stats.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace AI {
+
+struct Message {
+    std::string role; // "user" or "model"
+    std::string text;
+};
+
+struct CompletionRequest {
+    std::string model;
+    std::string system;            // static instructions, identical across queries
+    std::vector<Message> messages; // conversation so far; the last one is the new turn
+    bool keyed = false;            // reply maps ids to package lists instead of being one list
+
+    // Server-side cache holding system + messages[0, cached_messages) for
+    // cached_model. Providers that can't use it send everything instead.
+    std::string cached_content;
+    std::string cached_model;
+    size_t cached_messages = 0;
+};
+
+struct Completion {
+    std::string text;  // the model's reply, empty on failure
+    std::string error;
+};
+
+// A backend that turns a CompletionRequest into model text. Implementations
+// own the wire format (URL, payload shape, response path).
+class Provider {
+public:
+    virtual ~Provider() = default;
+
+    virtual Completion complete(const CompletionRequest &request) = 0;
+
+    // Base URL of the endpoint, used to warm the connection at startup.
+    virtual std::string baseUrl() const = 0;
+
+    // Stores system + messages of prefix on the server for ttlSeconds so later
+    // requests can reference it instead of resending it. Returns the cache
+    // name, or "" if the provider has no such facility or creation failed.
+    virtual std::string cachePrefix(const CompletionRequest &prefix, int ttlSeconds) {
+        (void)prefix;
+        (void)ttlSeconds;
+        return "";
+    }
+
+    // Deletes a cache made by cachePrefix before it expires; best effort.
+    virtual void dropCache(const std::string &name) { (void)name; }
+};
+
+// Gemini wire format, shared by generateContent and batch jobs.
+nlohmann::json geminiPayload(const CompletionRequest &request);
+std::string geminiReplyText(const nlohmann::json &response); // throws json::exception if absent
+
+// A concrete backend + model chosen for one tier of the ladder.
+struct Route {
+    std::string key;          // ladder entry as written; also the stats key
+    std::string providerName;
+    std::string model;
+};
+
+// Splits a ladder entry into provider and model.
+Route resolveRoute(const Config &config, const std::string &entry);
+
+// Picks among a tier's '|'-separated alternatives the one with the lowest
+// median latency. Unmeasured alternatives go first so every route gets sampled.
+Route chooseRoute(const Config &config, const std::string &tier, const LatencyStats &stats);
+
+// Builds the provider described by settings. Gemini providers fall back to
+// geminiApiKey when the settings don't name their own key variable.
+std::unique_ptr<Provider> makeProvider(const ProviderSettings &settings, const std::string &geminiApiKey);
+
+// Builds the provider a route points at; nullptr if it isn't configured.
+std::unique_ptr<Provider> makeProvider(const Config &config, const Route &route, const std::string &geminiApiKey);
+
+} // namespace AI
+
+#endif // PROVIDER_HPP
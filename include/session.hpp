@@ -0,0 +1,42 @@
+#ifndef SESSION_HPP
+#define SESSION_HPP
+
+#include "ai.hpp"
+#include "config.hpp"
+#include <string>
+#include <vector>
+
+namespace AI {
+
+// A multi-turn conversation kept in a compact local file, so follow-up
+// questions ("now do that for /home only") only send the new turn on top of
+// the history and, where the provider supports it, reference the stable
+// prefix from a server-side context cache instead of resending it.
+struct Session {
+    std::string path;
+    std::vector<Message> turns;   // user turns and compact model answers
+
+    // Server-side cache of system + turns[0, cached_turns) for cache_model.
+    std::string cache_name;
+    std::string cache_model;
+    size_t cached_turns = 0;
+    long long cache_expires = 0;  // unix time
+    // After a failed cache creation (a transient error, or a prefix still
+    // below the provider's minimum), retry once this time has passed or the
+    // prefix has grown to this many estimated tokens.
+    long long cache_retry_after = 0; // unix time
+    double cache_retry_tokens = 0;
+
+    // Loads (or starts) the session called name from the cache directory.
+    static Session load(const std::string &name);
+    void save() const;
+};
+
+// Answers a follow-up in the context of the session, trims the history to
+// config.session_token_budget and records the new exchange.
+PackageListResponse querySession(const Config &config, Session &session, const std::string &userQuery,
+                                 const std::string &apiKey, const PackageValidator &validator = nullptr);
+
+} // namespace AI
+
+#endif // SESSION_HPP
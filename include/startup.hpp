@@ -0,0 +1,12 @@
+#ifndef STARTUP_HPP
+#define STARTUP_HPP
+
+// Hidden child mode used by measureStartup(): writes one line as the very
+// first output of the process, optionally after loading the network stack.
+int startupProbe(bool withNetwork);
+
+// Re-executes this binary in probe mode and reports the exec-to-first-output
+// time with and without network (libcurl/TLS) initialization.
+int measureStartup(int runs = 25);
+
+#endif // STARTUP_HPP
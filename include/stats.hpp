@@ -0,0 +1,35 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include "json.hpp"
+#include <deque>
+#include <map>
+#include <string>
+
+using json = nlohmann::json;
+
+// Per-key latency samples and outcome counters, persisted between runs so
+// routing decisions (model tiers, providers, batch sizes) can be tuned.
+class LatencyStats {
+public:
+    struct Entry {
+        std::deque<double> samples_ms; // most recent samples, bounded
+        long calls = 0;
+        long rejected = 0;             // answers that had to be escalated
+    };
+
+    static LatencyStats load(const std::string &path);
+    void save(const std::string &path) const;
+
+    void record(const std::string &key, double ms, bool accepted);
+
+    // Median of the recent samples for key, or -1 when there are none.
+    double median(const std::string &key) const;
+
+    // Writes a human-readable table of all keys to stdout.
+    void print() const;
+
+    std::map<std::string, Entry> entries;
+};
+
+#endif // STATS_HPP
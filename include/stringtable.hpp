@@ -0,0 +1,49 @@
+#ifndef STRINGTABLE_HPP
+#define STRINGTABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Sorted (key, value) string pairs stored in a cache file and mapped
+// read-only, so an index built once is reopened with a single mmap. Each
+// file carries a fingerprint of the data it was built from.
+class StringTable {
+public:
+    StringTable() = default;
+    StringTable(StringTable &&other) noexcept;
+    StringTable &operator=(StringTable &&other) noexcept;
+    StringTable(const StringTable &) = delete;
+    StringTable &operator=(const StringTable &) = delete;
+    ~StringTable();
+
+    // Maps path if it holds a table with this fingerprint; empty otherwise.
+    static StringTable map(const std::string &path, uint64_t fingerprint);
+
+    // Sorts and deduplicates entries and writes them atomically to path.
+    static bool write(const std::string &path, uint64_t fingerprint,
+                      std::vector<std::pair<std::string, std::string>> entries);
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    std::string_view key(size_t index) const { return blob + offsets[2 * index]; }
+    std::string_view value(size_t index) const { return blob + offsets[2 * index + 1]; }
+
+    // Index of the first entry whose key is not less than key.
+    size_t lowerBound(std::string_view key) const;
+
+private:
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    size_t count = 0;
+    const uint32_t *offsets = nullptr;
+    const char *blob = nullptr;
+};
+
+// FNV-1a over each path with its size and mtime; files or directories that
+// change (a repository sync, an install) change the fingerprint.
+uint64_t fingerprintFiles(const std::vector<std::string> &paths);
+
+#endif // STRINGTABLE_HPP
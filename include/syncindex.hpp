@@ -0,0 +1,59 @@
+#ifndef SYNCINDEX_HPP
+#define SYNCINDEX_HPP
+
+#include "config.hpp"
+#include "stringtable.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Packages {
+
+// Every package name (and provided name) available from the configured
+// repositories, stored as a sorted string table in the cache directory and
+// mapped read-only. Rebuilt only when the package manager's sync databases
+// change, so lookups cost a binary search over the mapping.
+class SyncIndex {
+public:
+    // Opens the index for the configured package manager, rebuilding it from
+    // pacman's sync/*.db or apt's lists/*_Packages first if they changed.
+    static SyncIndex open(const Config &config);
+
+    // Builds an index file from the given sources (pacman .db tarballs or apt
+    // Packages files, compressed or not) and maps it. Sources are
+    // fingerprinted, so an up-to-date file is reused as is.
+    static SyncIndex open(const std::vector<std::string> &sources, const std::string &indexPath);
+
+    bool empty() const { return table.empty(); }
+    size_t size() const { return table.size(); }
+    bool contains(std::string_view name) const;
+
+    // The known name that differs from name at most in case and separators
+    // ("Python_Pip" for "python-pip"), or "".
+    std::string spelling(std::string_view name) const;
+
+    // spelling(), or else the known name within a few edits of name: none
+    // below 4 characters, one below 8 and two from there on, since a short
+    // name is always a couple of edits away from some unrelated package.
+    // "" if nothing is close enough.
+    std::string closest(std::string_view name) const;
+
+private:
+    // Entry indexes grouped by key length, built on first use so only the
+    // lengths a misspelling could have are scanned.
+    struct Lengths {
+        std::once_flag built;
+        std::vector<std::vector<uint32_t>> entries;
+    };
+    const std::vector<std::vector<uint32_t>> &byLength() const;
+
+    StringTable table; // folded names (see fold) as keys, the names as values
+    std::shared_ptr<Lengths> lengths = std::make_shared<Lengths>();
+};
+
+} // namespace Packages
+
+#endif // SYNCINDEX_HPP
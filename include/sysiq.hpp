@@ -0,0 +1,114 @@
+#ifndef SYSIQ_HPP
+#define SYSIQ_HPP
+
+#include "config.hpp"
+#include "json.hpp"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Executor;
+
+// The embeddable core of sysiq (libsysiq): answers queries in-process with
+// the same ladder, validation and installed-status checks as the binary, but
+// without prompts, terminal output or per-call start-up. A Client loads the
+// package indexes once, in the background, and every query after that reuses
+// them along with the warm connection.
+//
+//   SysIQ::Client client(*Config::read(path), apiKey);
+//   SysIQ::CancellationToken cancel;
+//   std::future<SysIQ::Result> answer = client.query("show disk usage", {"", cancel});
+//
+// Diagnostics go to the log (see log.hpp); nothing is written to stdout or
+// stderr.
+namespace SysIQ {
+
+// Shared flag a caller sets to abandon a query. Checked between stages, and
+// an HTTP request in flight is aborted within about a second.
+class CancellationToken {
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() { flag->store(true); }
+    bool cancelled() const { return flag->load(); }
+    const std::atomic<bool> &state() const { return *flag; }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+// One suggested package, checked against the system.
+struct Suggestion {
+    std::string package_name;   // as resolved against the repositories
+    std::string command;
+    bool installed = false;
+    bool known = false;         // the repositories have the package
+    std::string suggested_name; // the model's spelling, when it was corrected
+    std::string provided_by;    // another package that ships the command
+};
+
+struct Result {
+    std::string query;
+    std::vector<Suggestion> suggestions;
+    std::string error; // empty on success; "cancelled" when the token was set
+    double context_ms = 0;
+    double query_ms = 0;
+    double resolve_ms = 0;
+};
+
+// {"query", "packages": [...], "timings_ms": {...}} plus "error" if any; the
+// document --output writes.
+nlohmann::json toJson(const Result &result);
+
+// Runs a job on the caller's threads (a pool, an event loop). Jobs may block
+// on network and disk, and several may be queued at once.
+using Schedule = std::function<void(std::function<void()>)>;
+
+// Schedules onto an Executor.
+Schedule scheduleOn(Executor &executor);
+
+// Warm-up jobs a Client schedules when it is created (connection, installed
+// set, command and sync indexes). A schedule needs this many threads plus
+// one per concurrent query for the first query to start at once instead of
+// queueing behind them.
+const unsigned kWarmupJobs = 4;
+
+struct QueryOptions {
+    std::string session;      // answer as a follow-up in this --session conversation
+    CancellationToken cancel;
+};
+
+class Client {
+public:
+    // Without schedule, queries run on a small pool of the client's own and
+    // the destructor waits for them. With one, queued queries keep what they
+    // need alive by themselves.
+    Client(Config config, std::string apiKey, Schedule schedule = nullptr);
+    ~Client();
+
+    Client(const Client &) = delete;
+    Client &operator=(const Client &) = delete;
+
+    std::future<Result> query(const std::string &userQuery, QueryOptions options = {});
+
+    // Same, calling done on the scheduling thread instead of fulfilling a future.
+    void query(const std::string &userQuery, std::function<void(Result)> done, QueryOptions options = {});
+
+    // Installed status of one package, from the shared index.
+    std::future<bool> isInstalled(const std::string &package);
+
+    const Config &config() const;
+
+private:
+    struct State;
+    std::shared_ptr<State> state;
+    std::unique_ptr<Executor> pool; // only without a caller schedule
+    Schedule schedule;
+};
+
+} // namespace SysIQ
+
+#endif // SYSIQ_HPP
@@ -3,10 +3,29 @@
 
 #include "json.hpp"
 #include "config.hpp"
+#include "executor.hpp"
+#include <functional>
+#include <string>
+#include <vector>
 
 using json = nlohmann::json;
 
+// One piece of system context that can be added to a prompt.
+struct ContextProbe {
+    std::string name;                  // key in the resulting JSON
+    int cost_ms;                       // rough cost of running it
+    std::vector<std::string> keywords; // query words that make it relevant; empty = always
+    std::function<json(const Config &)> run;
+};
+
+const std::vector<ContextProbe> &contextProbes();
+
+// Runs, in parallel on executor, only the probes relevant to the query and
+// returns their results keyed by probe name.
+json gatherContext(const Config &config, const std::string &query, Executor &executor);
+
 // Gathers system information based on current environment and config.
+// Runs every probe regardless of the query.
 json getSystemInfo(const Config &config);
 
 #endif // SYSTEMINFO_HPP
@@ -0,0 +1,69 @@
+#ifndef TERMINAL_HPP
+#define TERMINAL_HPP
+
+#include <string>
+#include <vector>
+
+// Output to the user's terminal: styling that disappears when stdout is not a
+// terminal, and redrawn regions (progress bars) sent as diffs.
+namespace Terminal {
+
+// Whether stdout is a terminal. When it is not (piped, redirected to a file
+// or a log), no escape sequences are written at all.
+bool isTty();
+
+// Columns of the terminal on stdout; $COLUMNS or 80 when it can't be asked.
+int width();
+
+// code (an SGR escape such as "\x1b[32m") on a terminal, "" otherwise.
+const char *style(const char *code);
+
+enum class Color { Default, Green, Yellow, Red };
+
+// A run of text with one style.
+struct Span {
+    std::string text;
+    Color color = Color::Default;
+    bool bold = false;
+};
+
+using Line = std::vector<Span>;
+
+// "message [=====     ] 42%", with the bar shortened to fit the width.
+Line progressBar(double fraction, const std::string &message);
+
+// A block of lines redrawn in place. Each frame is composed into one buffer
+// and sent with a single write(2), and only what changed since the previous
+// frame is sent: unchanged lines are skipped and a changed line is rewritten
+// from its first differing cell. Lines are clipped to the terminal width.
+// Without a terminal, frames are only remembered and finish() prints the
+// last one as plain text.
+class Renderer {
+public:
+    ~Renderer() { finish(); }
+
+    void draw(const std::vector<Line> &lines);
+    void finish(); // leaves the last frame on screen, cursor below it
+    void erase();  // removes the block from the screen
+
+    struct Cell {
+        std::string glyph; // one UTF-8 code point
+        Color color = Color::Default;
+        bool bold = false;
+        bool operator==(const Cell &other) const {
+            return glyph == other.glyph && color == other.color && bold == other.bold;
+        }
+    };
+
+private:
+    void moveTo(size_t row, std::string &out);
+
+    std::vector<std::vector<Cell>> previous;
+    size_t rows = 0;       // lines of the block that exist on screen
+    size_t cursorRow = 0;  // row of the block the cursor is on
+    int lastWidth = 0;
+};
+
+} // namespace Terminal
+
+#endif // TERMINAL_HPP
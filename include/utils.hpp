@@ -9,4 +9,11 @@ std::string runCommand(const std::string &command);
 // Checks if a command (dependency) is available using "which".
 bool checkDependency(const std::string &cmd);
 
+// Reads a whole (small) file such as a sysfs/procfs entry; returns "" on error.
+std::string readFile(const std::string &path);
+
+// Returns $XDG_CACHE_HOME/sysiq (or ~/.cache/sysiq) joined with name,
+// creating the directory if needed.
+std::string cachePath(const std::string &name);
+
 #endif // UTILS_HPP
@@ -1,139 +1,196 @@
 #include "ai.hpp"
-#include <iostream>
 #include <string>
-#include <curl/curl.h>
+#include "http.hpp"
+#include "provider.hpp"
 #include "json.hpp"
+#include "jsonrepair.hpp"
+#include "log.hpp"
+#include <cctype>
 #include <sstream>
 #include <regex> // Include regex library
-#include <iomanip> // For std::quoted
+#include <chrono>
+#include "stats.hpp"
+#include "utils.hpp"
 
 using json = nlohmann::json;
 
-// Callback function for libcurl to write response data
-size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    std::string *str = static_cast<std::string*>(userp);
-    size_t totalSize = size * nmemb;
-    str->append(static_cast<char*>(contents), totalSize);
-    return totalSize;
+namespace AI {
+
+namespace {
+
+// Static instructions; kept separate from the query so providers can send them
+// as a system prompt (and cache them) instead of resending them in every turn.
+const char *kInstructions =
+    "Find a community-proven package and what syntax (the whole string to copy paste) to run with that package to resolve the user's query, "
+    "considering the system they describe. Use this JSON schema: packages = {\"package_name\": str, \"command\":str} Return: list[packages]. "
+    "Your reply will be parsed with the nlohmann/json library so the format must be correct, the command field has to be simply a string that "
+    "I will copy paste and execute in my terminal. Make sure first we get the package name then the command please.";
+
+std::string userTurn(const Config &config, const std::string &userQuery, const json &context) {
+    std::string turn = "Query: " + userQuery + "\n" + describeSystem(config);
+    if (context.is_object() && !context.empty()) {
+        turn += "\nContext: " + context.dump();
+    }
+    return turn;
 }
 
-namespace AI {
+// Package names as repositories spell them ("python3-pip", "libstdc++6").
+// Anything else (spaces, quotes, ';', '$(') is not a package and must never
+// reach a package manager command line.
+bool validPackageName(const std::string &name) {
+    if (name.empty() || name[0] == '-') return false;
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && std::string("@._+-").find(c) == std::string::npos) return false;
+    }
+    return true;
+}
+
+} // namespace
+
     template <>
     PackageListResponse from_json(const json& j) {
+        // Models sometimes wrap the list ({"packages": [...]}) or return a single object.
+        const json *list = &j;
+        json wrapped;
+        if (j.is_object()) {
+            if (j.contains("packages") && j["packages"].is_array()) {
+                list = &j["packages"];
+            } else {
+                wrapped = json::array({j});
+                list = &wrapped;
+            }
+        }
+
         PackageListResponse response;
-        std::vector<PackageInfo> packages;
-        for (const auto& element : j) { // Iterate directly over the array!
+        if (!list->is_array()) return response;
+        for (const auto& element : *list) { // Iterate directly over the array!
+            // Keep only complete entries; one malformed item shouldn't sink the rest.
+            if (!element.is_object()) continue;
+            auto name = element.find("package_name");
+            auto command = element.find("command");
+            if (name == element.end() || command == element.end() || !name->is_string() || !command->is_string()) continue;
+
             PackageInfo packageInfo;
-            packageInfo.package_name = element["package_name"].get<std::string>();
-            packageInfo.command = element["command"].get<std::string>();
-            packages.push_back(packageInfo);
+            packageInfo.package_name = name->get<std::string>();
+            packageInfo.command = command->get<std::string>();
+            if (packageInfo.command.empty() || !validPackageName(packageInfo.package_name)) continue;
+            response.packages.push_back(packageInfo);
         }
-        response.packages = packages;
         return response;
     }
 
-// Safely parse a JSON string, handling errors
-nlohmann::json safe_parse(const std::string& str) {
-    try {
-        return json::parse(str);
-    } catch (json::parse_error& e) {
-        std::cerr << "JSON Parse error: " << e.what() << std::endl;
-        return {}; // Return an empty JSON object to indicate failure
+json toJson(const PackageListResponse &response) {
+    json packages = json::array();
+    for (const PackageInfo &package : response.packages) {
+        packages.push_back({{"package_name", package.package_name}, {"command", package.command}});
     }
+    return {{"packages", packages}};
 }
 
-// Function to query the Gemini API and get a response
-std::string queryAI(const std::string &prompt, const std::string &apiKey) {
-    std::string modelName = "https://generativelanguage.googleapis.com/v1beta/models/gemini-2.0-flash:generateContent";
-
-    json payload = {
-        {"contents", {
-            {
-                {"parts", {
-                    {{"text", prompt}}
-                }}
-            }
-        }},
-        {"generationConfig", {
-             {"response_mime_type", "application/json"}
-        }}
-    };
-
-    std::string payloadStr = payload.dump();
-    std::string responseStr;
-
-    CURL *curl = curl_easy_init();
-    if (!curl) {
-        std::cerr << "Error initializing curl.\n";
-        return "";
+// Parse a JSON string, repairing fences, trailing commas and truncation if needed
+nlohmann::json safe_parse(const std::string& str) {
+    json result = JsonRepair::parse(str);
+    if (result.is_discarded()) {
+        LOG_WARN("model output is not json, even after repair");
+        return {}; // Return an empty JSON object to indicate failure
     }
+    return result;
+}
 
-    struct curl_slist *headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-
-    std::string urlWithKey = modelName + "?key=" + apiKey;
-
-    // Construct the curl command string for logging - NOW MATCHING EXAMPLE EXACTLY
-    std::stringstream curlCommand;
-    curlCommand << "curl "
-                << std::quoted(urlWithKey) << " \\\n"  // URL first
-                << "-H " << std::quoted("Content-Type: application/json") << " \\\n" // Headers next
-                << "-d " << std::quoted(payloadStr); // Data last
-
-    std::cout << "Executing curl command:\n" << curlCommand.str() << "\n" << std::endl; // Log the full curl command
-
-    curl_easy_setopt(curl, CURLOPT_URL, urlWithKey.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, payloadStr.c_str()); // Attach JSON payload
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &responseStr);
-    curl_easy_setopt(curl, CURLOPT_POST, 1L); // Still use POST option for libcurl
-
-    CURLcode res = curl_easy_perform(curl);
+std::string describeSystem(const Config &config) {
+    return "System: " + config.distro + " " + config.desktop + " " + config.shell + " " + config.terminal;
+}
 
-    if (res != CURLE_OK) {
-        std::cerr << "Curl error: " << curl_easy_strerror(res) << "\n";
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        return "";
+void preconnect(const Config &config) {
+    if (config.models.empty()) return;
+    Route route = chooseRoute(config, config.models.front(), LatencyStats::load(cachePath("tiers.json")));
+    auto settings = config.providers.find(route.providerName);
+    if (settings != config.providers.end()) {
+        Http::transport().preconnect(settings->second.base_url);
     }
+}
 
-    long http_code = 0;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-    if (http_code != 200) {
-        std::cerr << "HTTP error: " << http_code << "\n";
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        return "";
+bool requiresGeminiKey(const Config &config) {
+    for (const std::string &tier : config.models) {
+        std::stringstream alternatives(tier);
+        std::string entry;
+        while (std::getline(alternatives, entry, '|')) {
+            auto settings = config.providers.find(resolveRoute(config, entry).providerName);
+            if (settings != config.providers.end() && settings->second.type == "gemini" && settings->second.api_key_env.empty()) {
+                return true;
+            }
+        }
     }
-
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-
-    std::cout << "Raw AI response:\n" << responseStr << "\n";
-    return responseStr;
+    return false;
 }
 
-PackageListResponse queryPackageList(const Config &config, const json &sysInfo, const std::string &userQuery, const std::string &apiKey) {
-    std::string prompt = "Find a community-proven package and what syntax (the whole string to copy paste) to run with that package  to resolve this query: " + userQuery  + "considering im using " + config.distro + " " +
-                         config.desktop + " " + config.shell + " " + config.terminal +
-                         + " using this JSON schema: packages = {\"package_name\": str, \"command\":str} Return: list[packages]. Your reply will be parsed with the nlohmann/json library so the format must be correct, the command field has to be simply a string that I will copy paste and execute in my terminal. Make sure first we get the package name then the command please.";
-    std::cout << "Prompt being sent to AI:\n" << prompt << std::endl; // Added logging
-
-    std::string response = queryAI(prompt, apiKey);
-    if (response.empty()) return {};
-
+// Extracts the package list from the model's reply text.
+PackageListResponse parsePackageList(const std::string &jsonText) {
     try {
-        json rawResult = json::parse(response);
-        std::string jsonText = rawResult["candidates"][0]["content"]["parts"][0]["text"].get<std::string>();
         json result = safe_parse(jsonText);
-        std::cout << "Parsed JSON response:\n" << result.dump(4) << "\n"; // Added logging
-        PackageListResponse packageListResponse = from_json<PackageListResponse>(result);
-        return packageListResponse;
+        LOG_TRACE("parsed reply", {"json", result});
+        return from_json<PackageListResponse>(result);
     } catch (json::exception &e) {
-        std::cerr << "JSON parsing error: " << e.what() << "\n";
+        LOG_WARN("package list malformed", {"error", e.what()});
         return {};
     }
 }
 
-} // namespace AI
\ No newline at end of file
+CompletionRequest packageListRequest(const Config &config, const std::string &userQuery, const json &context) {
+    CompletionRequest request;
+    request.system = kInstructions;
+    request.messages = {{"user", userTurn(config, userQuery, context)}};
+    return request;
+}
+
+PackageListResponse queryPackageList(const Config &config, const json &sysInfo, const std::string &userQuery, const std::string &apiKey, const PackageValidator &validator) {
+    return queryPackageList(config, packageListRequest(config, userQuery, sysInfo), apiKey, validator);
+}
+
+PackageListResponse queryPackageList(const Config &config, CompletionRequest request, const std::string &apiKey, const PackageValidator &validator) {
+    LOG_DEBUG("prompt", {"system_bytes", request.system.size()}, {"turn_bytes", request.messages.back().text.size()},
+              {"turns", request.messages.size()});
+    LOG_TRACE("prompt text", {"system", request.system}, {"turn", request.messages.back().text});
+
+    // Walk the model ladder, fastest tier first, and only escalate when the
+    // answer is unusable: no parseable packages, or packages that don't exist.
+    std::string statsPath = cachePath("tiers.json");
+    LatencyStats stats = LatencyStats::load(statsPath);
+    PackageListResponse best;
+    for (size_t tier = 0; tier < config.models.size(); ++tier) {
+        Route route = chooseRoute(config, config.models[tier], stats);
+        const std::string &model = route.key;
+        std::unique_ptr<Provider> provider = makeProvider(config, route, apiKey);
+        if (!provider) continue;
+        request.model = route.model;
+
+        auto start = std::chrono::steady_clock::now();
+        std::string response = provider->complete(request).text;
+        PackageListResponse candidate = response.empty() ? PackageListResponse{} : parsePackageList(response);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        bool accepted = !candidate.packages.empty();
+        if (accepted && validator) {
+            for (const PackageInfo &package : candidate.packages) {
+                if (!validator(package.package_name)) {
+                    LOG_INFO("unknown package suggested", {"model", model}, {"package", package.package_name});
+                    accepted = false;
+                }
+            }
+        }
+        bool lastTier = tier + 1 == config.models.size();
+        if (!response.empty()) stats.record(model, ms, accepted || lastTier); // Transport failures say nothing about the model.
+        LOG_INFO("model tier", {"model", model}, {"ms", static_cast<long>(ms)}, {"packages", candidate.packages.size()},
+                 {"outcome", accepted ? "accepted" : lastTier ? "last tier" : "escalating"});
+
+        if (!candidate.packages.empty() && best.packages.empty()) best = candidate;
+        if (accepted) {
+            best = candidate;
+            break;
+        }
+    }
+    stats.save(statsPath);
+    return best;
+}
+
+} // namespace AI
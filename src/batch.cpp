@@ -0,0 +1,152 @@
+#include "batch.hpp"
+#include "log.hpp"
+#include "provider.hpp"
+#include "stats.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+
+namespace AI {
+
+namespace {
+
+const char *kBatchInstructions =
+    "You will receive a JSON object mapping query ids to user queries. For every query, find a community-proven package and what syntax "
+    "(the whole string to copy paste) to run with that package to resolve it, considering the system described. Return one JSON object "
+    "mapping every id, exactly once, to list[packages] using this JSON schema: packages = {\"package_name\": str, \"command\":str}. "
+    "The command field has to be simply a string that can be copy pasted and executed in a terminal.";
+
+// Batch sizing limits. Output is the binding constraint: a reply cut off at
+// the token limit loses every query after the cut.
+const int kMinBatch = 1;
+const int kMaxBatch = 64;
+const double kTargetLatencyMs = 15000.0;
+const double kMaxOutputTokens = 8192.0;
+const double kMaxInputTokens = 30000.0;
+
+// Adaptive state persisted between runs.
+struct BatchState {
+    int batch_size = 8;
+    double output_tokens_per_query = 150.0;
+};
+
+BatchState loadState(const std::string &path) {
+    BatchState state;
+    std::ifstream file(path);
+    json j = json::parse(file, nullptr, false);
+    if (j.is_object()) {
+        state.batch_size = std::clamp(j.value("batch_size", state.batch_size), kMinBatch, kMaxBatch);
+        state.output_tokens_per_query = std::max(10.0, j.value("output_tokens_per_query", state.output_tokens_per_query));
+    }
+    return state;
+}
+
+void saveState(const std::string &path, const BatchState &state) {
+    std::ofstream file(path);
+    file << json{{"batch_size", state.batch_size}, {"output_tokens_per_query", state.output_tokens_per_query}}.dump();
+}
+
+// Rough token estimate; good enough for budgeting.
+double estimateTokens(const std::string &text) {
+    return text.size() / 4.0;
+}
+
+} // namespace
+
+std::vector<PackageListResponse> queryPackageLists(const Config &config, const std::vector<std::string> &queries, const std::string &apiKey) {
+    std::vector<PackageListResponse> results(queries.size());
+    if (queries.empty() || config.models.empty()) return results;
+
+    std::string statePath = cachePath("batch.json");
+    std::string statsPath = cachePath("tiers.json");
+    BatchState state = loadState(statePath);
+    LatencyStats stats = LatencyStats::load(statsPath);
+
+    Route route = chooseRoute(config, config.models.front(), stats);
+    std::unique_ptr<Provider> provider = makeProvider(config, route, apiKey);
+    if (!provider) return results;
+
+    std::deque<size_t> pending;
+    for (size_t i = 0; i < queries.size(); ++i) pending.push_back(i);
+    std::vector<int> attempts(queries.size(), 0);
+    std::vector<size_t> fallback;
+
+    while (!pending.empty()) {
+        // Fit the batch to the adaptive size and to both token budgets.
+        size_t size = std::min<size_t>(state.batch_size, pending.size());
+        size = std::min<size_t>(size, std::max(1.0, kMaxOutputTokens * 0.8 / state.output_tokens_per_query));
+        json batch = json::object();
+        std::vector<size_t> members;
+        double inputTokens = 0;
+        while (members.size() < size && !pending.empty()) {
+            size_t index = pending.front();
+            inputTokens += estimateTokens(queries[index]) + 8;
+            if (!members.empty() && inputTokens > kMaxInputTokens) break;
+            pending.pop_front();
+            members.push_back(index);
+            attempts[index]++;
+            batch["q" + std::to_string(index)] = queries[index];
+        }
+
+        CompletionRequest request;
+        request.model = route.model;
+        request.system = kBatchInstructions;
+        request.keyed = true;
+        request.messages = {{"user", describeSystem(config) + "\nQueries: " + batch.dump()}};
+
+        auto start = std::chrono::steady_clock::now();
+        std::string text = provider->complete(request).text;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Demultiplex the keyed reply.
+        json reply = text.empty() ? json() : safe_parse(text);
+        size_t answered = 0;
+        std::vector<size_t> missing;
+        for (size_t index : members) {
+            std::string id = "q" + std::to_string(index);
+            if (reply.is_object() && reply.contains(id)) {
+                results[index] = from_json<PackageListResponse>(reply[id]);
+            }
+            if (results[index].packages.empty()) {
+                missing.push_back(index);
+            } else {
+                answered++;
+            }
+        }
+
+        // Adapt: additive increase while fast and complete, halve on loss or slowness.
+        if (answered > 0) {
+            double perQuery = estimateTokens(text) / answered;
+            state.output_tokens_per_query = 0.7 * state.output_tokens_per_query + 0.3 * perQuery;
+        }
+        if (!missing.empty() || ms > kTargetLatencyMs) {
+            state.batch_size = std::max(kMinBatch, state.batch_size / 2);
+        } else if (ms < kTargetLatencyMs / 2 && members.size() == static_cast<size_t>(state.batch_size)) {
+            state.batch_size = std::min(kMaxBatch, state.batch_size + 2);
+        }
+        if (!text.empty()) stats.record("batch:" + route.key, ms / members.size(), missing.empty());
+        LOG_INFO("batch", {"queries", members.size()}, {"model", route.key}, {"ms", static_cast<long>(ms)},
+                 {"answered", answered}, {"next_batch_size", state.batch_size});
+
+        // Dropped queries get one more batched attempt, then go through the ladder alone.
+        for (auto it = missing.rbegin(); it != missing.rend(); ++it) {
+            if (attempts[*it] < 2 && !text.empty()) {
+                pending.push_front(*it);
+            } else {
+                fallback.push_back(*it);
+            }
+        }
+    }
+
+    saveState(statePath, state);
+    stats.save(statsPath);
+
+    for (size_t index : fallback) {
+        results[index] = queryPackageList(config, json::object(), queries[index], apiKey);
+    }
+    return results;
+}
+
+} // namespace AI
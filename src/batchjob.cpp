@@ -0,0 +1,268 @@
+#include "batchjob.hpp"
+#include "ai.hpp"
+#include "http.hpp"
+#include "provider.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace AI {
+
+namespace {
+
+struct JobState {
+    std::string corpus_hash;
+    std::string model;
+    std::string job;       // e.g. "batches/123"; empty until submitted
+    std::string status;    // last state reported by the API
+};
+
+JobState loadState(const std::string &path) {
+    JobState state;
+    std::ifstream file(path);
+    json j = json::parse(file, nullptr, false);
+    if (j.is_object()) {
+        state.corpus_hash = j.value("corpus_hash", "");
+        state.model = j.value("model", "");
+        state.job = j.value("job", "");
+        state.status = j.value("status", "");
+    }
+    return state;
+}
+
+void saveState(const std::string &path, const JobState &state) {
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath);
+        file << json{{"corpus_hash", state.corpus_hash}, {"model", state.model},
+                     {"job", state.job}, {"status", state.status}}.dump(4);
+    }
+    std::rename(tmpPath.c_str(), path.c_str());
+}
+
+// FNV-1a; only used to notice that the corpus changed under a saved job.
+std::string hashCorpus(const std::vector<std::string> &queries) {
+    unsigned long long hash = 1469598103934665603ULL;
+    for (const std::string &query : queries) {
+        for (unsigned char c : query + "\n") {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+    }
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", hash);
+    return buffer;
+}
+
+bool endsWith(const std::string &value, const std::string &suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Polls stop after this many failures in a row; the state file is kept, so
+// a rerun resumes the job.
+const int kMaxPollFailures = 10;
+
+// Client errors other than rate limiting: retrying cannot help (the job was
+// deleted or expired, or the key is bad).
+bool permanentFailure(long status) {
+    return status >= 400 && status < 500 && status != 429;
+}
+
+json getJson(const std::string &url, std::string &error, long &status) {
+    Http::Request request;
+    request.method = "GET";
+    request.url = url;
+    Http::Response response = Http::transport().perform(request);
+    status = response.status;
+    if (!response.error.empty() || response.status != 200) {
+        error = response.error.empty() ? "HTTP " + std::to_string(response.status) : response.error;
+        return json();
+    }
+    error.clear();
+    return json::parse(response.body, nullptr, false);
+}
+
+// Collects (key, GenerateContentResponse) pairs from a finished batch,
+// whether the results came back inline or as a JSONL responses file. False
+// if the responses file could not be downloaded.
+bool collectResults(const json &batch, const std::string &base, const std::string &apiKey,
+                    std::vector<std::pair<std::string, json>> &results) {
+    const json &output = batch.contains("response") ? batch["response"] : batch.value("output", json::object());
+
+    auto addResult = [&](const json &item) {
+        if (!item.is_object()) return;
+        const json &metadata = item.contains("metadata") && item["metadata"].is_object() ? item["metadata"] : item;
+        json key = metadata.value("key", json());
+        if (key.is_string() && !key.get<std::string>().empty() && item.contains("response")) results.emplace_back(key.get<std::string>(), item["response"]);
+    };
+
+    json inlined = output.value("inlinedResponses", json());
+    if (inlined.is_object()) inlined = inlined.value("inlinedResponses", json::array());
+    if (inlined.is_array()) {
+        for (const json &item : inlined) addResult(item);
+    }
+
+    std::string file = output.value("responsesFile", "");
+    if (!file.empty()) {
+        Http::Request request;
+        request.method = "GET";
+        request.url = base + "download/v1beta/" + file + ":download?alt=media&key=" + apiKey;
+        request.timeout_seconds = 600;
+        Http::Response response = Http::transport().perform(request);
+        if (!response.error.empty() || response.status != 200) {
+            std::cerr << "Downloading " << file << " failed: "
+                      << (response.error.empty() ? "HTTP " + std::to_string(response.status) : response.error) << "\n";
+            return false;
+        }
+        size_t start = 0;
+        while (start < response.body.size()) {
+            size_t end = response.body.find('\n', start);
+            if (end == std::string::npos) end = response.body.size();
+            json line = json::parse(response.body.substr(start, end - start), nullptr, false);
+            if (line.is_object()) addResult(line);
+            start = end + 1;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool runBatchJob(const Config &config, const BatchJobOptions &options, const std::string &apiKey) {
+    std::ifstream corpus(options.corpus_path);
+    if (!corpus) {
+        std::cerr << "Cannot read corpus " << options.corpus_path << "\n";
+        return false;
+    }
+    std::vector<std::string> queries;
+    for (std::string line; std::getline(corpus, line);) {
+        if (!line.empty()) queries.push_back(line);
+    }
+    if (queries.empty() || config.models.empty()) return true;
+
+    Route route = resolveRoute(config, config.models.front().substr(0, config.models.front().find('|')));
+    auto settings = config.providers.find(route.providerName);
+    if (settings == config.providers.end() || settings->second.type != "gemini") {
+        std::cerr << "Batch jobs need a Gemini provider in the first model tier.\n";
+        return false;
+    }
+    std::string base = settings->second.base_url;
+    if (!base.empty() && base.back() != '/') base += '/';
+    std::string key = apiKey;
+    if (!settings->second.api_key_env.empty()) {
+        const char *env = std::getenv(settings->second.api_key_env.c_str());
+        key = env ? env : "";
+    }
+
+    JobState state = loadState(options.state_path);
+    std::string corpusHash = hashCorpus(queries);
+    if (!state.job.empty() && state.corpus_hash != corpusHash) {
+        std::cerr << "State file " << options.state_path << " belongs to a different corpus; starting a new job.\n";
+        state = JobState{};
+    }
+
+    if (state.job.empty()) {
+        json requests = json::array();
+        for (size_t i = 0; i < queries.size(); ++i) {
+            requests.push_back({
+                {"request", geminiPayload(packageListRequest(config, queries[i]))},
+                {"metadata", {{"key", "q" + std::to_string(i)}}}
+            });
+        }
+        json payload = {{"batch", {
+            {"display_name", "sysiq-" + corpusHash},
+            {"input_config", {{"requests", {{"requests", requests}}}}}
+        }}};
+
+        Http::Request request;
+        request.url = base + "v1beta/models/" + route.model + ":batchGenerateContent?key=" + key;
+        request.headers = {"Content-Type: application/json"};
+        request.body = payload.dump();
+        request.timeout_seconds = 300;
+        Http::Response response = Http::transport().perform(request);
+        json operation = json::parse(response.body, nullptr, false);
+        if (!response.error.empty() || response.status != 200 || !operation.is_object() || !operation.contains("name")) {
+            std::cerr << "Batch submission failed: " << (response.error.empty() ? "HTTP " + std::to_string(response.status) : response.error) << "\n";
+            return false;
+        }
+        state.corpus_hash = corpusHash;
+        state.model = route.model;
+        state.job = operation["name"].get<std::string>();
+        state.status = "SUBMITTED";
+        saveState(options.state_path, state);
+        std::cout << "Submitted " << queries.size() << " queries as " << state.job << "\n";
+    } else {
+        std::cout << "Resuming " << state.job << " (last status " << state.status << ")\n";
+    }
+
+    // Poll with exponential backoff until the job reaches a terminal state.
+    double delay = options.initial_poll_seconds;
+    json batch;
+    for (int failures = 0;;) {
+        std::string error;
+        long httpStatus = 0;
+        batch = getJson(base + "v1beta/" + state.job + "?key=" + key, error, httpStatus);
+        if (batch.is_object()) {
+            failures = 0;
+            const json &metadata = batch.contains("metadata") ? batch["metadata"] : batch;
+            std::string status = metadata.value("state", batch.value("done", false) ? "SUCCEEDED" : "RUNNING");
+            if (status != state.status) {
+                state.status = status;
+                saveState(options.state_path, state);
+                std::cout << state.job << ": " << status << "\n";
+            }
+            if (endsWith(status, "FAILED") || endsWith(status, "CANCELLED") || endsWith(status, "EXPIRED")) {
+                std::cerr << "Batch job " << state.job << " ended as " << status << "\n";
+                return false;
+            }
+            if (endsWith(status, "SUCCEEDED") || batch.value("done", false)) break;
+        } else {
+            std::cerr << "Polling " << state.job << " failed: " << error << "\n";
+            if (permanentFailure(httpStatus) || ++failures >= kMaxPollFailures) return false;
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(delay));
+        delay = std::min(delay * 1.5, options.max_poll_seconds);
+    }
+
+    // Skip ids already written by an earlier, interrupted run.
+    std::set<std::string> written;
+    {
+        std::ifstream existing(options.output_path);
+        for (std::string line; std::getline(existing, line);) {
+            json j = json::parse(line, nullptr, false);
+            if (j.is_object() && j.contains("id") && j["id"].is_string()) written.insert(j["id"].get<std::string>());
+        }
+    }
+
+    std::vector<std::pair<std::string, json>> results;
+    if (!collectResults(batch, base, key, results)) return false;
+    std::ofstream output(options.output_path, std::ios::app);
+    size_t emitted = 0;
+    for (const auto &[id, response] : results) {
+        size_t index = id.size() > 1 ? std::strtoul(id.c_str() + 1, nullptr, 10) : queries.size();
+        if (index >= queries.size() || written.count(id)) continue;
+
+        PackageListResponse packages;
+        try {
+            packages = from_json<PackageListResponse>(safe_parse(geminiReplyText(response)));
+        } catch (json::exception &) {
+            // Blocked or empty candidate; record the query with no packages.
+        }
+        json line = toJson(packages);
+        line["id"] = id;
+        line["query"] = queries[index];
+        output << line.dump() << "\n";
+        written.insert(id);
+        emitted++;
+    }
+    output.flush();
+    std::cout << "Wrote " << emitted << " results to " << options.output_path << " (" << written.size() << "/" << queries.size() << " total)\n";
+    return true;
+}
+
+} // namespace AI
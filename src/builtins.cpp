@@ -0,0 +1,299 @@
+#include "builtins.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cctype>
+#include <cstdio>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <thread>
+#include <unordered_set>
+
+namespace Builtins {
+
+namespace {
+
+// Queries that ask to change something rather than report it go to the AI.
+const std::unordered_set<std::string> kActionWords = {
+    "install", "change", "set", "configure", "enable", "disable", "remove", "delete",
+    "increase", "decrease", "resize", "format", "mount", "unmount", "clean", "block",
+    "allow", "limit", "watch", "monitor", "graph", "kill", "restart", "reset", "fix",
+    "add", "create", "setup", "extend", "shrink", "encrypt", "backup", "copy", "move",
+    "clone", "wipe", "erase", "repair", "recover", "upgrade", "update", "assign", "forward",
+    "share", "scan", "test", "benchmark", "optimize", "why", "convert", "save", "compress",
+    "split", "merge", "edit", "open", "run", "play", "record", "sync", "transfer", "send"
+};
+
+// How-to questions ("how do I ...", "can I ...") go to the AI too; "how much"
+// and "how long" are reports and stay.
+const std::vector<std::vector<std::string>> kHowTo = {
+    {"how", "to"}, {"how", "do"}, {"how", "can"}, {"how", "should"}, {"can", "i"}, {"should", "i"}
+};
+
+// Dropped before comparing a query with a handler's keywords.
+const std::unordered_set<std::string> kFillerWords = {
+    "show", "me", "my", "the", "what", "whats", "s", "is", "are", "check", "display", "get",
+    "current", "how", "much", "please", "list", "print", "tell", "of", "this", "machine",
+    "computer", "system", "pc"
+};
+
+// Words after which a query names what it asks about ("ip of google",
+// "memory used by chrome"), and words that still mean this machine there.
+const std::unordered_set<std::string> kTargetWords = {"of", "for", "by", "on", "from"};
+const std::unordered_set<std::string> kSelfWords = {
+    "each", "all", "every", "local", "localhost", "here", "it", "i", "us", "mine", "now", "today",
+    "partition", "partitions", "drive", "drives", "filesystems", "interface", "interfaces", "cores", "cpus"
+};
+
+std::vector<std::string> tokenize(const std::string &query) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : query) {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        } else if (!word.empty()) {
+            words.push_back(word);
+            word.clear();
+        }
+    }
+    if (!word.empty()) words.push_back(word);
+    return words;
+}
+
+// Whether phrase (words separated by spaces) occurs as consecutive words.
+bool containsPhrase(const std::vector<std::string> &words, const std::vector<std::string> &phrase) {
+    if (phrase.empty() || phrase.size() > words.size()) return false;
+    return std::search(words.begin(), words.end(), phrase.begin(), phrase.end()) != words.end();
+}
+
+std::string formatBytes(double bytes) {
+    const char *units[] = {"B", "K", "M", "G", "T", "P"};
+    int unit = 0;
+    while (bytes >= 1024.0 && unit < 5) {
+        bytes /= 1024.0;
+        ++unit;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f%s" : "%.1f%s", bytes, units[unit]);
+    return buffer;
+}
+
+int prefixLength(const sockaddr *netmask) {
+    if (!netmask) return 0;
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+    if (netmask->sa_family == AF_INET) {
+        bytes = reinterpret_cast<const unsigned char *>(&reinterpret_cast<const sockaddr_in *>(netmask)->sin_addr);
+        length = 4;
+    } else if (netmask->sa_family == AF_INET6) {
+        bytes = reinterpret_cast<const unsigned char *>(&reinterpret_cast<const sockaddr_in6 *>(netmask)->sin6_addr);
+        length = 16;
+    }
+    int bits = 0;
+    for (size_t i = 0; i < length; ++i) {
+        bits += __builtin_popcount(bytes[i]);
+    }
+    return bits;
+}
+
+std::string ipAddresses() {
+    ifaddrs *addresses = nullptr;
+    if (getifaddrs(&addresses) != 0) return "Unable to read network interfaces.\n";
+
+    std::ostringstream out;
+    for (ifaddrs *a = addresses; a; a = a->ifa_next) {
+        if (!a->ifa_addr || !(a->ifa_flags & IFF_UP) || (a->ifa_flags & IFF_LOOPBACK)) continue;
+        int family = a->ifa_addr->sa_family;
+        if (family != AF_INET && family != AF_INET6) continue;
+
+        char host[INET6_ADDRSTRLEN] = {};
+        const void *raw = family == AF_INET
+            ? static_cast<const void *>(&reinterpret_cast<sockaddr_in *>(a->ifa_addr)->sin_addr)
+            : static_cast<const void *>(&reinterpret_cast<sockaddr_in6 *>(a->ifa_addr)->sin6_addr);
+        inet_ntop(family, raw, host, sizeof(host));
+        out << a->ifa_name << "\t" << (family == AF_INET ? "inet " : "inet6 ")
+            << host << "/" << prefixLength(a->ifa_netmask) << "\n";
+    }
+    freeifaddrs(addresses);
+    std::string result = out.str();
+    return result.empty() ? "No active network interfaces.\n" : result;
+}
+
+std::string diskSpace() {
+    // Real filesystems only; skip proc/sys/cgroup/tmpfs-style pseudo mounts.
+    static const std::unordered_set<std::string> kPseudo = {
+        "proc", "sysfs", "devtmpfs", "devpts", "tmpfs", "cgroup", "cgroup2", "securityfs",
+        "pstore", "debugfs", "tracefs", "configfs", "fusectl", "mqueue", "hugetlbfs",
+        "bpf", "autofs", "binfmt_misc", "efivarfs", "rpc_pipefs", "nsfs", "squashfs", "overlay"
+    };
+
+    std::ostringstream out;
+    char line[128];
+    std::snprintf(line, sizeof(line), "%-24s %8s %8s %8s %5s  %s\n", "Filesystem", "Size", "Used", "Avail", "Use%", "Mounted on");
+    out << line;
+
+    std::istringstream mounts(readFile("/proc/self/mounts"));
+    std::string device, mountPoint, type, rest;
+    std::set<dev_t> seen;
+    while (mounts >> device >> mountPoint >> type && std::getline(mounts, rest)) {
+        if (kPseudo.count(type)) continue;
+        struct stat st;
+        struct statvfs vfs;
+        if (stat(mountPoint.c_str(), &st) != 0 || !seen.insert(st.st_dev).second) continue;
+        if (statvfs(mountPoint.c_str(), &vfs) != 0 || vfs.f_blocks == 0) continue;
+
+        double size = static_cast<double>(vfs.f_blocks) * vfs.f_frsize;
+        double avail = static_cast<double>(vfs.f_bavail) * vfs.f_frsize;
+        double used = size - static_cast<double>(vfs.f_bfree) * vfs.f_frsize;
+        int percent = used + avail > 0 ? static_cast<int>(used * 100.0 / (used + avail) + 0.5) : 0;
+        std::snprintf(line, sizeof(line), "%-24s %8s %8s %8s %4d%%  %s\n", device.c_str(),
+                      formatBytes(size).c_str(), formatBytes(used).c_str(), formatBytes(avail).c_str(),
+                      percent, mountPoint.c_str());
+        out << line;
+    }
+    return out.str();
+}
+
+std::string memoryUsage() {
+    std::istringstream meminfo(readFile("/proc/meminfo"));
+    std::string key;
+    long long value;
+    std::string unit;
+    long long total = 0, available = 0, swapTotal = 0, swapFree = 0;
+    while (meminfo >> key >> value) {
+        std::getline(meminfo, unit);
+        if (key == "MemTotal:") total = value;
+        else if (key == "MemAvailable:") available = value;
+        else if (key == "SwapTotal:") swapTotal = value;
+        else if (key == "SwapFree:") swapFree = value;
+    }
+    if (total == 0) return "Unable to read /proc/meminfo.\n";
+
+    std::ostringstream out;
+    out << "Memory: " << formatBytes((total - available) * 1024.0) << " used, "
+        << formatBytes(available * 1024.0) << " available, " << formatBytes(total * 1024.0) << " total\n";
+    out << "Swap:   " << formatBytes((swapTotal - swapFree) * 1024.0) << " used, "
+        << formatBytes(swapTotal * 1024.0) << " total\n";
+    return out.str();
+}
+
+std::string uptime() {
+    double seconds = 0;
+    if (std::sscanf(readFile("/proc/uptime").c_str(), "%lf", &seconds) != 1) return "Unable to read /proc/uptime.\n";
+    long total = static_cast<long>(seconds);
+    long days = total / 86400, hours = total % 86400 / 3600, minutes = total % 3600 / 60;
+
+    std::ostringstream out;
+    out << "up ";
+    if (days) out << days << (days == 1 ? " day, " : " days, ");
+    out << hours << (hours == 1 ? " hour, " : " hours, ") << minutes << (minutes == 1 ? " minute\n" : " minutes\n");
+    return out.str();
+}
+
+std::string cpuLoad() {
+    double one = 0, five = 0, fifteen = 0;
+    if (std::sscanf(readFile("/proc/loadavg").c_str(), "%lf %lf %lf", &one, &five, &fifteen) != 3) {
+        return "Unable to read /proc/loadavg.\n";
+    }
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    char line[128];
+    std::snprintf(line, sizeof(line), "Load average: %.2f, %.2f, %.2f (1, 5, 15 min) on %u CPUs (%.0f%% of capacity)\n",
+                  one, five, fifteen, cores, one * 100.0 / cores);
+    return line;
+}
+
+// A hostname or address ("google.com", "10.0.0.1", "::1").
+bool isHostToken(const std::string &token) {
+    size_t dot = token.find('.');
+    bool dotted = dot != std::string::npos && dot > 0 && dot + 1 < token.size() &&
+                  std::isalnum(static_cast<unsigned char>(token[dot - 1])) && std::isalnum(static_cast<unsigned char>(token[dot + 1]));
+    return dotted || std::count(token.begin(), token.end(), ':') >= 2;
+}
+
+} // namespace
+
+const std::vector<Handler> &registry() {
+    static const std::vector<Handler> handlers = {
+        {"ip", {"my ip", "ip address", "ip addresses", "ipv4 address", "ipv6 address", "local ip", "network address", "network addresses"},
+         {"ip", "ips", "ipv4", "ipv6"},
+         {"public", "external", "wan", "router", "gateway", "dns"}, ipAddresses},
+        {"disk", {"disk usage", "disk space", "free space", "free disk", "storage usage", "storage space", "partition usage", "space left"},
+         {"disk", "disks", "storage", "df"},
+         {"speed", "health", "smart", "benchmark", "model", "temperature"}, diskSpace},
+        {"memory", {"memory usage", "ram usage", "swap usage", "free memory", "free ram", "used memory", "memory used", "how much ram", "how much memory"},
+         {"memory", "ram", "swap", "mem"},
+         {"speed", "model", "slots", "leak", "process", "processes"}, memoryUsage},
+        {"uptime", {"how long running", "how long has it been running", "how long up", "how long has it been up", "last boot", "booted at"},
+         {"uptime"},
+         {}, uptime},
+        {"load", {"load average", "system load", "cpu load", "cpu usage", "cpu utilization", "cpu utilisation"},
+         {"load", "loadavg"},
+         {"model", "temperature", "frequency", "cores", "process", "processes"}, cpuLoad},
+    };
+    return handlers;
+}
+
+const Handler *match(const std::string &query) {
+    std::vector<std::string> words = tokenize(query);
+    std::unordered_set<std::string> present(words.begin(), words.end());
+    for (const std::string &word : words) {
+        if (kActionWords.count(word)) return nullptr;
+    }
+    for (const std::vector<std::string> &form : kHowTo) {
+        if (containsPhrase(words, form)) return nullptr;
+    }
+    // The handlers report on this machine; a query about another host or a
+    // process is for the AI.
+    std::istringstream tokens(query);
+    for (std::string token; tokens >> token;) {
+        if (isHostToken(token)) return nullptr;
+    }
+    static const std::unordered_set<std::string> vocabulary = [] {
+        std::unordered_set<std::string> known;
+        for (const Handler &handler : registry()) {
+            for (const std::string &phrase : handler.phrases) {
+                for (const std::string &word : tokenize(phrase)) known.insert(word);
+            }
+            known.insert(handler.keywords.begin(), handler.keywords.end());
+        }
+        return known;
+    }();
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (!kTargetWords.count(words[i])) continue;
+        size_t next = i + 1;
+        while (next < words.size() && (kFillerWords.count(words[next]) || kSelfWords.count(words[next]))) ++next;
+        if (next < words.size() && !vocabulary.count(words[next]) && !kTargetWords.count(words[next])) return nullptr;
+    }
+
+    std::vector<std::string> content;
+    for (const std::string &word : words) {
+        if (!kFillerWords.count(word)) content.push_back(word);
+    }
+
+    const Handler *best = nullptr;
+    size_t bestScore = 0;
+    for (const Handler &handler : registry()) {
+        bool excluded = std::any_of(handler.exclusions.begin(), handler.exclusions.end(),
+                                    [&](const std::string &w) { return present.count(w) > 0; });
+        if (excluded) continue;
+        if (content.size() == 1 && std::find(handler.keywords.begin(), handler.keywords.end(), content.front()) != handler.keywords.end()) {
+            return &handler;
+        }
+        for (const std::string &phrase : handler.phrases) {
+            std::vector<std::string> phraseWords = tokenize(phrase);
+            // Longer phrases are more specific, so they win ties across handlers.
+            if (containsPhrase(words, phraseWords) && phraseWords.size() > bestScore) {
+                best = &handler;
+                bestScore = phraseWords.size();
+            }
+        }
+    }
+    return best;
+}
+
+} // namespace Builtins
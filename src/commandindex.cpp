@@ -0,0 +1,127 @@
+#include "commandindex.hpp"
+#include "batchread.hpp"
+#include "localdb.hpp"
+#include "utils.hpp"
+#include <filesystem>
+#include <sstream>
+
+namespace Packages {
+
+namespace {
+
+const char *const kDpkgInfo = "/var/lib/dpkg/info";
+
+// "usr/bin/lsusb" or "/usr/sbin/ip" -> the basename; "" for anything that
+// is not an executable directory entry.
+std::string_view executableName(std::string_view path) {
+    if (!path.empty() && path.front() == '/') path.remove_prefix(1);
+    for (std::string_view dir : {"usr/bin/", "usr/sbin/", "bin/", "sbin/", "usr/local/bin/", "usr/games/"}) {
+        if (path.size() > dir.size() && path.compare(0, dir.size(), dir) == 0) {
+            std::string_view name = path.substr(dir.size());
+            return name.find('/') == std::string_view::npos ? name : std::string_view();
+        }
+    }
+    return {};
+}
+
+void addExecutables(std::string_view list, const std::string &package,
+                    std::vector<std::pair<std::string, std::string>> &entries) {
+    while (!list.empty()) {
+        size_t end = list.find('\n');
+        std::string_view name = executableName(list.substr(0, end));
+        if (!name.empty()) entries.emplace_back(std::string(name), package);
+        if (end == std::string_view::npos) break;
+        list.remove_prefix(end + 1);
+    }
+}
+
+std::vector<std::string> subdirectories(const std::string &root) {
+    std::vector<std::string> dirs;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(root, error)) {
+        if (entry.is_directory(error)) dirs.push_back(entry.path().string());
+    }
+    return dirs;
+}
+
+} // namespace
+
+CommandIndex CommandIndex::open(const Config &config) {
+    if (config.package_manager.find("pacman") != std::string::npos) {
+        return open(kPacmanLocalDb, "", cachePath("commands-index.bin"));
+    }
+    if (config.package_manager.find("apt") != std::string::npos || config.package_manager.find("dpkg") != std::string::npos) {
+        return open("", kDpkgInfo, cachePath("commands-index.bin"));
+    }
+    return {};
+}
+
+CommandIndex CommandIndex::open(const std::string &pacmanLocalDb, const std::string &dpkgInfoDir, const std::string &indexPath) {
+    // Installing or removing a package adds or removes an entry in these
+    // directories, which changes their mtime.
+    CommandIndex index;
+    std::vector<std::string> roots;
+    for (const std::string &root : {pacmanLocalDb, dpkgInfoDir}) {
+        if (!root.empty()) roots.push_back(root);
+    }
+    uint64_t fingerprint = fingerprintFiles(roots);
+    index.table = StringTable::map(indexPath, fingerprint);
+    if (!index.table.empty()) return index;
+
+    std::vector<std::string> paths;
+    std::vector<std::string> packages;
+    if (!pacmanLocalDb.empty()) {
+        // Each entry has a desc (for the name) and a files list.
+        for (const std::string &dir : subdirectories(pacmanLocalDb)) {
+            paths.push_back(dir + "/desc");
+            paths.push_back(dir + "/files");
+        }
+    }
+    size_t pacmanPaths = paths.size();
+    if (!dpkgInfoDir.empty()) {
+        std::error_code error;
+        for (const auto &entry : std::filesystem::directory_iterator(dpkgInfoDir, error)) {
+            std::string file = entry.path().filename().string();
+            if (file.size() <= 5 || file.compare(file.size() - 5, 5, ".list") != 0) continue;
+            paths.push_back(entry.path().string());
+            std::string package = file.substr(0, file.size() - 5);
+            packages.push_back(package.substr(0, package.find(':'))); // drop ":amd64"
+        }
+    }
+
+    std::vector<std::string> contents = BatchRead::readFiles(paths);
+    std::vector<std::pair<std::string, std::string>> entries;
+    for (size_t i = 0; i + 1 < pacmanPaths; i += 2) {
+        std::string name = parseDesc(contents[i]).name;
+        if (!name.empty()) addExecutables(contents[i + 1], name, entries);
+    }
+    for (size_t i = pacmanPaths; i < paths.size(); ++i) {
+        addExecutables(contents[i], packages[i - pacmanPaths], entries);
+    }
+    if (StringTable::write(indexPath, fingerprint, std::move(entries))) {
+        index.table = StringTable::map(indexPath, fingerprint);
+    }
+    return index;
+}
+
+std::vector<std::string> CommandIndex::owners(std::string_view command) const {
+    std::vector<std::string> result;
+    for (size_t i = table.lowerBound(command); i < table.size() && table.key(i) == command; ++i) {
+        result.emplace_back(table.value(i));
+    }
+    return result;
+}
+
+std::string commandProgram(const std::string &command) {
+    std::istringstream words(command);
+    std::string word;
+    while (words >> word) {
+        if (word == "sudo" || word == "env" || word == "exec" || word == "doas") continue;
+        if (word.front() == '-') continue; // options to sudo/env
+        if (word.find('=') != std::string::npos && word.front() != '/') continue; // FOO=bar
+        return word.substr(word.rfind('/') + 1);
+    }
+    return "";
+}
+
+} // namespace Packages
@@ -1,4 +1,5 @@
 #include "config.hpp"
+#include "log.hpp"
 #include <fstream>
 #include <iostream>
 #include <filesystem> // Necessary for creating directories
@@ -6,7 +7,6 @@
 namespace fs = std::filesystem;
 
 Config Config::load(const std::string &configPath) {
-    Config config;
     std::ifstream configFile(configPath);
 
     if (!configFile.is_open()) {
@@ -27,6 +27,23 @@ Config Config::load(const std::string &configPath) {
         return interactiveSetup();
     }
 
+    std::string error;
+    std::optional<Config> loaded = read(configPath, &error);
+    if (!loaded) {
+        std::cerr << "Error loading config file: " << error << ". Using interactive setup." << std::endl;
+        return interactiveSetup();
+    }
+    return *loaded;
+}
+
+std::optional<Config> Config::read(const std::string &configPath, std::string *error) {
+    std::ifstream configFile(configPath);
+    if (!configFile.is_open()) {
+        if (error) *error = "cannot open " + configPath;
+        return std::nullopt;
+    }
+
+    Config config;
     try {
         json configJson;
         configFile >> configJson;
@@ -36,9 +53,25 @@ Config Config::load(const std::string &configPath) {
         config.shell = configJson.value("shell", "");
         config.terminal = configJson.value("terminal", "");
         config.package_manager = configJson.value("package_manager", "");
+        if (configJson.contains("models") && configJson["models"].is_array() && !configJson["models"].empty()) {
+            config.models = configJson["models"].get<std::vector<std::string>>();
+        }
+        if (configJson.contains("providers") && configJson["providers"].is_object()) {
+            for (auto it = configJson["providers"].begin(); it != configJson["providers"].end(); ++it) {
+                ProviderSettings settings;
+                settings.type = it->value("type", "openai");
+                settings.base_url = it->value("base_url", "");
+                settings.api_key_env = it->value("api_key_env", "");
+                config.providers[it.key()] = settings;
+            }
+        }
+        config.provider = configJson.value("provider", config.provider);
+        config.session_token_budget = configJson.value("session_token_budget", config.session_token_budget);
+        config.prefetch_rate_kib = configJson.value("prefetch_rate_kib", config.prefetch_rate_kib);
+        config.exec_in_place = configJson.value("exec_in_place", config.exec_in_place);
     } catch (const std::exception& e) {
-        std::cerr << "Error loading config file: " << e.what() << ". Using interactive setup." << std::endl;
-        return interactiveSetup();
+        if (error) *error = e.what();
+        return std::nullopt;
     }
 
     return config;
@@ -51,13 +84,25 @@ void Config::save(const std::string &configPath) const {
     configJson["shell"] = shell;
     configJson["terminal"] = terminal;
     configJson["package_manager"] = package_manager;
+    configJson["models"] = models;
+    configJson["provider"] = provider;
+    configJson["session_token_budget"] = session_token_budget;
+    configJson["prefetch_rate_kib"] = prefetch_rate_kib;
+    configJson["exec_in_place"] = exec_in_place;
+    for (const auto &[name, settings] : providers) {
+        configJson["providers"][name] = {
+            {"type", settings.type},
+            {"base_url", settings.base_url},
+            {"api_key_env", settings.api_key_env}
+        };
+    }
 
 
     std::ofstream configFile(configPath);
     if (configFile.is_open()) {
         configFile << configJson.dump(4); // Use dump(4) for pretty printing
         if(configFile.good()){
-          std::cout << "Configuration saved to " << configPath << std::endl;
+          LOG_INFO("configuration saved", {"path", configPath});
         }else{
           std::cerr << "Error writing to config file!" << std::endl;
         }
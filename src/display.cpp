@@ -0,0 +1,98 @@
+#include "display.hpp"
+#include "utils.hpp"
+#include <dirent.h>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Detailed timing / display descriptors live at these offsets in the base block.
+const int kDescriptorOffsets[] = {54, 72, 90, 108};
+
+std::string descriptorText(const unsigned char *d) {
+    std::string text;
+    for (int i = 5; i < 18 && d[i] != 0x0A; ++i) {
+        text += static_cast<char>(d[i]);
+    }
+    while (!text.empty() && text.back() == ' ') text.pop_back();
+    return text;
+}
+
+} // namespace
+
+bool parseEdid(const std::string &edid, MonitorInfo &monitor) {
+    static const unsigned char header[] = {0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00};
+    if (edid.size() < 128 || edid.compare(0, 8, reinterpret_cast<const char *>(header), 8) != 0) {
+        return false;
+    }
+    const unsigned char *e = reinterpret_cast<const unsigned char *>(edid.data());
+
+    // Manufacturer id: three 5-bit letters packed big-endian into bytes 8-9.
+    unsigned id = (e[8] << 8) | e[9];
+    monitor.manufacturer = {static_cast<char>('A' - 1 + ((id >> 10) & 0x1F)),
+                            static_cast<char>('A' - 1 + ((id >> 5) & 0x1F)),
+                            static_cast<char>('A' - 1 + (id & 0x1F))};
+
+    bool haveTiming = false;
+    for (int offset : kDescriptorOffsets) {
+        const unsigned char *d = e + offset;
+        unsigned pixelClock = d[0] | (d[1] << 8); // in 10 kHz units
+        if (pixelClock != 0) {
+            // The first detailed timing descriptor is the preferred mode.
+            if (haveTiming) continue;
+            int hActive = d[2] | ((d[4] & 0xF0) << 4);
+            int hBlank = d[3] | ((d[4] & 0x0F) << 8);
+            int vActive = d[5] | ((d[7] & 0xF0) << 4);
+            int vBlank = d[6] | ((d[7] & 0x0F) << 8);
+            monitor.width = hActive;
+            monitor.height = vActive;
+            double total = static_cast<double>(hActive + hBlank) * (vActive + vBlank);
+            if (total > 0) {
+                monitor.refresh_hz = std::round(pixelClock * 10000.0 / total * 100.0) / 100.0;
+            }
+            haveTiming = true;
+        } else if (d[3] == 0xFC) {
+            monitor.name = descriptorText(d);
+        }
+    }
+    return true;
+}
+
+std::vector<MonitorInfo> probeMonitors(const std::string &drmRoot) {
+    std::vector<MonitorInfo> monitors;
+    DIR *dir = opendir(drmRoot.c_str());
+    if (!dir) return monitors;
+
+    while (dirent *entry = readdir(dir)) {
+        std::string connector = entry->d_name;
+        // Connector directories look like "card0-eDP-1"; skip "card0", "renderD128", etc.
+        if (connector.compare(0, 4, "card") != 0 || connector.find('-') == std::string::npos) continue;
+
+        std::string base = drmRoot + "/" + connector;
+        if (readFile(base + "/status").compare(0, 9, "connected") != 0) continue;
+
+        MonitorInfo monitor;
+        monitor.connector = connector;
+        parseEdid(readFile(base + "/edid"), monitor);
+
+        // Without a usable EDID timing, fall back to the first (preferred) mode.
+        if (monitor.width == 0) {
+            std::string modes = readFile(base + "/modes");
+            std::sscanf(modes.c_str(), "%dx%d", &monitor.width, &monitor.height);
+        }
+        monitors.push_back(monitor);
+    }
+    closedir(dir);
+    return monitors;
+}
+
+json toJson(const MonitorInfo &monitor) {
+    json j = {
+        {"connector", monitor.connector},
+        {"resolution", std::to_string(monitor.width) + "x" + std::to_string(monitor.height)}
+    };
+    if (!monitor.name.empty()) j["name"] = monitor.name;
+    if (!monitor.manufacturer.empty()) j["manufacturer"] = monitor.manufacturer;
+    if (monitor.refresh_hz > 0) j["refresh_hz"] = monitor.refresh_hz;
+    return j;
+}
@@ -0,0 +1,126 @@
+#include "dpkgstatus.hpp"
+#include <cstring>
+#include <string_view>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Packages {
+
+namespace {
+
+// A line is interesting if it starts with 'P' (Package, Provides), 'S'
+// (Status) or is empty (end of stanza). These find the next '\n' that is
+// followed by one of those, or return size.
+size_t nextCandidateScalar(const char *data, size_t from, size_t size) {
+    while (from < size) {
+        const char *hit = static_cast<const char *>(std::memchr(data + from, '\n', size - from));
+        if (!hit || hit + 1 >= data + size) return size;
+        char next = hit[1];
+        if (next == 'P' || next == 'S' || next == '\n') return hit - data;
+        from = hit - data + 1;
+    }
+    return size;
+}
+
+// 32 bytes per step: compare the block and the block shifted by one, so a
+// single mask marks every "\nP", "\nS" and "\n\n" pair. Description bodies
+// and dependency lists, most of the file, are skipped without branching.
+__attribute__((target("avx2"))) size_t nextCandidateAvx2(const char *data, size_t from, size_t size) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i upperP = _mm256_set1_epi8('P');
+    const __m256i upperS = _mm256_set1_epi8('S');
+    while (from + 33 <= size) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + from));
+        __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + from + 1));
+        __m256i wanted = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(next, upperP), _mm256_cmpeq_epi8(next, upperS)),
+                                         _mm256_cmpeq_epi8(next, newline));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block, newline), wanted)));
+        if (mask) return from + __builtin_ctz(mask);
+        from += 32;
+    }
+    return nextCandidateScalar(data, from, size);
+}
+
+bool startsWith(std::string_view line, std::string_view prefix) {
+    return line.size() >= prefix.size() && line.compare(0, prefix.size(), prefix) == 0;
+}
+
+// "foo (= 1.0), bar, baz:any" -> foo, bar, baz
+void addProvides(std::string_view list, std::vector<std::string> &provides) {
+    while (!list.empty()) {
+        size_t comma = list.find(',');
+        std::string_view item = list.substr(0, comma);
+        size_t begin = item.find_first_not_of(' ');
+        if (begin != std::string_view::npos) {
+            item = item.substr(begin);
+            provides.emplace_back(item.substr(0, item.find_first_of(" (:|")));
+        }
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+}
+
+} // namespace
+
+DpkgStatus parseDpkgStatus(const char *data, size_t size, bool installedOnly) {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    DpkgStatus status;
+
+    std::string_view name;
+    std::string_view provides;
+    bool installed = false;
+    auto finishStanza = [&]() {
+        if ((installed || !installedOnly) && !name.empty()) {
+            status.installed.emplace_back(name);
+            addProvides(provides, status.provides);
+        }
+        name = provides = {};
+        installed = false;
+    };
+
+    size_t lineStart = 0;
+    while (lineStart < size) {
+        const char *end = static_cast<const char *>(std::memchr(data + lineStart, '\n', size - lineStart));
+        size_t lineEnd = end ? end - data : size;
+        std::string_view line(data + lineStart, lineEnd - lineStart);
+
+        if (line.empty()) {
+            finishStanza();
+        } else if (startsWith(line, "Package: ")) {
+            name = line.substr(9);
+        } else if (startsWith(line, "Status: ")) {
+            // "install ok installed"; "config-files", "half-installed" etc. don't count.
+            installed = line.size() >= 18 && line.compare(line.size() - 10, 10, " installed") == 0;
+        } else if (startsWith(line, "Provides: ")) {
+            provides = line.substr(10);
+        }
+
+        size_t next = avx2 ? nextCandidateAvx2(data, lineEnd, size) : nextCandidateScalar(data, lineEnd, size);
+        lineStart = next + 1;
+    }
+    finishStanza();
+    return status;
+}
+
+DpkgStatus loadDpkgStatus(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return {};
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return {};
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return {};
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    DpkgStatus status = parseDpkgStatus(static_cast<const char *>(mapped), size);
+    munmap(mapped, size);
+    return status;
+}
+
+} // namespace Packages
@@ -0,0 +1,239 @@
+#include "http.hpp"
+#include <curl/curl.h> // types and constants only; symbols come from dlopen
+#include <dlfcn.h>
+#include <mutex>
+#include <vector>
+
+namespace Http {
+
+namespace {
+
+// The subset of the libcurl API we use, resolved at runtime.
+struct CurlApi {
+    CURLcode (*global_init)(long);
+    CURL *(*easy_init)();
+    CURLcode (*easy_setopt)(CURL *, CURLoption, ...);
+    CURLcode (*easy_perform)(CURL *);
+    CURLcode (*easy_getinfo)(CURL *, CURLINFO, ...);
+    void (*easy_reset)(CURL *);
+    const char *(*easy_strerror)(CURLcode);
+    curl_slist *(*slist_append)(curl_slist *, const char *);
+    void (*slist_free_all)(curl_slist *);
+    // Optional (libcurl >= 7.57 for shared connections); null if missing.
+    CURLSH *(*share_init)();
+    CURLSHcode (*share_setopt)(CURLSH *, CURLSHoption, ...);
+};
+
+template <typename T>
+bool resolve(void *library, const char *symbol, T &target) {
+    target = reinterpret_cast<T>(dlsym(library, symbol));
+    return target != nullptr;
+}
+
+thread_local const std::atomic<bool> *cancelFlag = nullptr;
+
+// Called by libcurl during a transfer; a non-zero return aborts it.
+int cancelCallback(void *flag, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    return static_cast<const std::atomic<bool> *>(flag)->load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+size_t writeCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+    std::string *str = static_cast<std::string *>(userp);
+    size_t totalSize = size * nmemb;
+    str->append(static_cast<char *>(contents), totalSize);
+    return totalSize;
+}
+
+class CurlTransport : public Transport {
+public:
+    Response perform(const Request &request) override {
+        const std::atomic<bool> *cancel = CancelScope::current();
+        Response response;
+        if (cancel && cancel->load()) {
+            response.error = "cancelled";
+            return response;
+        }
+        CURL *handle = acquireHandle();
+        if (!handle) {
+            response.error = "libcurl is not available";
+            return response;
+        }
+
+        curl_slist *headers = nullptr;
+        for (const std::string &header : request.headers) {
+            headers = api.slist_append(headers, header.c_str());
+        }
+
+        api.easy_setopt(handle, CURLOPT_URL, request.url.c_str());
+        api.easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+        api.easy_setopt(handle, CURLOPT_TIMEOUT, request.timeout_seconds);
+        api.easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeCallback);
+        api.easy_setopt(handle, CURLOPT_WRITEDATA, &response.body);
+        if (cancel) {
+            api.easy_setopt(handle, CURLOPT_NOPROGRESS, 0L);
+            api.easy_setopt(handle, CURLOPT_XFERINFOFUNCTION, cancelCallback);
+            api.easy_setopt(handle, CURLOPT_XFERINFODATA, cancel);
+        }
+        if (request.method == "POST") {
+            api.easy_setopt(handle, CURLOPT_POST, 1L);
+            api.easy_setopt(handle, CURLOPT_POSTFIELDS, request.body.c_str());
+            api.easy_setopt(handle, CURLOPT_POSTFIELDSIZE, static_cast<long>(request.body.size()));
+        } else if (request.method != "GET") {
+            api.easy_setopt(handle, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+            if (!request.body.empty()) {
+                api.easy_setopt(handle, CURLOPT_POSTFIELDS, request.body.c_str());
+            }
+        }
+
+        CURLcode res = api.easy_perform(handle);
+        if (res == CURLE_ABORTED_BY_CALLBACK) {
+            response.error = "cancelled";
+        } else if (res != CURLE_OK) {
+            response.error = api.easy_strerror(res);
+        } else {
+            api.easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &response.status);
+        }
+        api.slist_free_all(headers);
+        releaseHandle(handle);
+        return response;
+    }
+
+    void preconnect(const std::string &url) override {
+        CURL *handle = acquireHandle();
+        if (!handle) return;
+        // A bodiless request leaves a warm connection in the shared cache.
+        api.easy_setopt(handle, CURLOPT_URL, url.c_str());
+        api.easy_setopt(handle, CURLOPT_NOBODY, 1L);
+        api.easy_setopt(handle, CURLOPT_TIMEOUT, 5L);
+        api.easy_perform(handle); // Failure is harmless; perform() just connects itself.
+        releaseHandle(handle);
+    }
+
+    bool load() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return loadLocked();
+    }
+
+    bool loaded() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return library != nullptr;
+    }
+
+private:
+    bool loadLocked() {
+        if (library) return true;
+        if (loadFailed) return false;
+        for (const char *name : {"libcurl.so.4", "libcurl.so", "libcurl-gnutls.so.4"}) {
+            library = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+            if (library) break;
+        }
+        bool ok = library &&
+                  resolve(library, "curl_global_init", api.global_init) &&
+                  resolve(library, "curl_easy_init", api.easy_init) &&
+                  resolve(library, "curl_easy_setopt", api.easy_setopt) &&
+                  resolve(library, "curl_easy_perform", api.easy_perform) &&
+                  resolve(library, "curl_easy_getinfo", api.easy_getinfo) &&
+                  resolve(library, "curl_easy_reset", api.easy_reset) &&
+                  resolve(library, "curl_easy_strerror", api.easy_strerror) &&
+                  resolve(library, "curl_slist_append", api.slist_append) &&
+                  resolve(library, "curl_slist_free_all", api.slist_free_all);
+        if (!ok || api.global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+            if (library) dlclose(library);
+            library = nullptr;
+            loadFailed = true;
+            return false;
+        }
+        if (resolve(library, "curl_share_init", api.share_init) && resolve(library, "curl_share_setopt", api.share_setopt)) {
+            share = api.share_init();
+        }
+        if (share) {
+            api.share_setopt(share, CURLSHOPT_LOCKFUNC, lockShared);
+            api.share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShared);
+            api.share_setopt(share, CURLSHOPT_USERDATA, this);
+            api.share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            api.share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+            api.share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT); // refused by old versions
+        }
+        return true;
+    }
+
+    static void lockShared(CURL *, curl_lock_data data, curl_lock_access, void *self) {
+        static_cast<CurlTransport *>(self)->sharedLocks[data % CURL_LOCK_DATA_LAST].lock();
+    }
+
+    static void unlockShared(CURL *, curl_lock_data data, void *self) {
+        static_cast<CurlTransport *>(self)->sharedLocks[data % CURL_LOCK_DATA_LAST].unlock();
+    }
+
+    // An idle easy handle, or a new one when every handle is in a transfer.
+    // The mutex covers only the pool: transfers run concurrently and share
+    // connections, DNS and TLS sessions (those opened by preconnect()
+    // included) through the share handle.
+    CURL *acquireHandle() {
+        CURL *handle = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!loadLocked()) return nullptr;
+            if (!idle.empty()) {
+                handle = idle.back();
+                idle.pop_back();
+            }
+        }
+        if (handle) {
+            api.easy_reset(handle); // Keeps open connections and the DNS cache.
+        } else {
+            handle = api.easy_init();
+        }
+        if (handle) {
+            api.easy_setopt(handle, CURLOPT_NOSIGNAL, 1L); // transfers run on several threads
+            if (share) api.easy_setopt(handle, CURLOPT_SHARE, share);
+        }
+        return handle;
+    }
+
+    void releaseHandle(CURL *handle) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(handle);
+    }
+
+    std::mutex mutex; // library loading and the idle pool
+    void *library = nullptr;
+    bool loadFailed = false;
+    CurlApi api{};
+    CURLSH *share = nullptr;
+    std::mutex sharedLocks[CURL_LOCK_DATA_LAST];
+    std::vector<CURL *> idle;
+};
+
+CurlTransport &curlTransport() {
+    static CurlTransport instance;
+    return instance;
+}
+
+} // namespace
+
+CancelScope::CancelScope(const std::atomic<bool> &flag) : previous(cancelFlag) {
+    cancelFlag = &flag;
+}
+
+CancelScope::~CancelScope() {
+    cancelFlag = previous;
+}
+
+const std::atomic<bool> *CancelScope::current() {
+    return cancelFlag;
+}
+
+Transport &transport() {
+    return curlTransport();
+}
+
+bool loadNetwork() {
+    return curlTransport().load();
+}
+
+bool networkLoaded() {
+    return curlTransport().loaded();
+}
+
+} // namespace Http
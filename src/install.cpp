@@ -0,0 +1,207 @@
+#include "install.hpp"
+#include "packages.hpp"
+#include "process.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace Packages {
+
+namespace {
+
+const size_t kOutputLines = 20;
+
+bool isPacman(const Config &config) { return config.package_manager.find("pacman") != std::string::npos; }
+
+bool isApt(const Config &config) { return config.package_manager.find("apt") != std::string::npos; }
+
+// pacman only reads ParallelDownloads (and any download rate limit, via
+// XferCommand) from its configuration file, so point it at a copy of
+// /etc/pacman.conf with those set. Returns "" when nothing needs changing or
+// the system file cannot be read.
+std::string pacmanConfig(const std::string &name, int rateKib) {
+    std::string system = readFile("/etc/pacman.conf");
+    if (system.empty()) return "";
+    std::vector<std::string> settings;
+    if (system.find("\nParallelDownloads") == std::string::npos) settings.push_back("ParallelDownloads = 5");
+    if (rateKib > 0 && checkDependency("curl")) {
+        settings.push_back("XferCommand = /usr/bin/curl --limit-rate " + std::to_string(rateKib) + "k -L -C - -f -s -o %o %u");
+    }
+    if (settings.empty()) return "";
+
+    // The options go right after "[options]"; commented-out defaults stay as they are.
+    std::stringstream in(system);
+    std::string out;
+    for (std::string line; std::getline(in, line);) {
+        std::string bare = line.substr(std::min(line.size(), line.find_first_not_of(" \t")));
+        if (rateKib > 0 && bare.compare(0, 12, "XferCommand ") == 0) continue;
+        out += line + "\n";
+        if (line == "[options]") {
+            for (const std::string &setting : settings) out += setting + "\n";
+        }
+    }
+
+    std::string path = cachePath(name);
+    std::ofstream file(path, std::ios::trunc);
+    file << out;
+    return file ? path : "";
+}
+
+// Drops ANSI escape sequences (pacman's Color option) from a line.
+std::string stripEscapes(const std::string &line) {
+    std::string plain;
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] == '\x1b' && i + 1 < line.size() && line[i + 1] == '[') {
+            i += 2;
+            while (i < line.size() && !(line[i] >= '@' && line[i] <= '~')) ++i;
+            continue;
+        }
+        plain += line[i];
+    }
+    return plain;
+}
+
+// Trailing "NN%" of a progress bar line, or -1.
+double trailingPercent(const std::string &line) {
+    size_t end = line.find_last_not_of(' ');
+    if (end == std::string::npos || line[end] != '%') return -1;
+    size_t begin = line.find_last_of(' ', end);
+    begin = begin == std::string::npos ? 0 : begin + 1;
+    return std::atof(line.substr(begin, end - begin).c_str());
+}
+
+} // namespace
+
+std::vector<std::string> installCommand(const Config &config, const std::vector<std::string> &packages) {
+    std::vector<std::string> command;
+    if (geteuid() != 0) command = {"sudo", "-n"}; // credentials are checked up front
+    if (isPacman(config)) {
+        command.insert(command.end(), {"pacman", "-S", "--needed", "--noconfirm"});
+        std::string parallelConfig = pacmanConfig("pacman-install.conf", 0);
+        if (!parallelConfig.empty()) command.insert(command.end(), {"--config", parallelConfig});
+    } else if (isApt(config)) {
+        // Status-Fd gives machine-readable progress; queueing per access
+        // rather than per host lets downloads from one mirror run in parallel.
+        command.insert(command.end(), {"env", "DEBIAN_FRONTEND=noninteractive", "apt-get", "install", "-y",
+                                       "-o", "APT::Status-Fd=1", "-o", "Acquire::Queue-Mode=access",
+                                       "-o", "Dpkg::Use-Pty=0"});
+    } else {
+        command.insert(command.end(), {config.package_manager, "-S"});
+    }
+    command.insert(command.end(), packages.begin(), packages.end());
+    return command;
+}
+
+bool parseInstallProgress(const std::string &rawLine, InstallProgress &progress) {
+    std::string line = stripEscapes(rawLine);
+
+    // apt: "dlstatus:<n>:<percent>:<message>" and "pmstatus:<pkg>:<percent>:<message>".
+    for (const char *prefix : {"dlstatus:", "pmstatus:"}) {
+        if (line.compare(0, 9, prefix) != 0) continue;
+        size_t first = line.find(':', 9);
+        size_t second = first == std::string::npos ? first : line.find(':', first + 1);
+        if (second == std::string::npos) return false;
+        double percent = std::atof(line.substr(first + 1, second - first - 1).c_str());
+        bool downloading = prefix[0] == 'd';
+        progress.stage = downloading ? "downloading" : "installing";
+        progress.fraction = (downloading ? 0.0 : 0.5) + 0.5 * std::clamp(percent, 0.0, 100.0) / 100.0;
+        progress.line = line.substr(second + 1);
+        return true;
+    }
+
+    // pacman: "(2/3) installing htop  [####---] 60%", "Total ( 1/2)  ... 40%",
+    // or a single download line ending in a percentage.
+    double percent = trailingPercent(line);
+    if (percent < 0) return false;
+    size_t open = line.find('(');
+    size_t slash = line.find('/', open == std::string::npos ? 0 : open);
+    size_t close = line.find(')', slash == std::string::npos ? 0 : slash);
+    long index = 1, total = 1;
+    std::string stage = "downloading";
+    if (open != std::string::npos && slash != std::string::npos && close != std::string::npos && open < 8) {
+        index = std::atol(line.substr(open + 1, slash - open - 1).c_str());
+        total = std::atol(line.substr(slash + 1, close - slash - 1).c_str());
+        std::stringstream rest(line.substr(close + 1));
+        rest >> stage;
+        if (line.compare(0, 5, "Total") == 0) stage = "downloading";
+    }
+    if (total < 1 || index < 1 || index > total) return false;
+
+    // Downloads fill the first half, checks the next tenth, installation the rest.
+    double base = 0.0, span = 0.5;
+    if (stage == "checking" || stage == "loading") {
+        base = 0.5;
+        span = 0.1;
+    } else if (stage != "downloading") {
+        base = 0.6;
+        span = 0.4;
+    }
+    progress.stage = stage;
+    progress.fraction = base + span * ((index - 1) + std::clamp(percent, 0.0, 100.0) / 100.0) / total;
+    progress.line = line;
+    return true;
+}
+
+InstallResult install(const Config &config, const std::vector<std::string> &packages,
+                      const std::function<void(const InstallProgress &)> &onProgress) {
+    InstallResult result;
+    if (packages.empty()) {
+        result.exit_code = 0;
+        return result;
+    }
+    // Ask for the sudo password on the real terminal; the transaction itself
+    // then runs unattended on its pty.
+    if (geteuid() != 0 && std::system("sudo -v") != 0) {
+        result.output.push_back("sudo authentication failed");
+        result.failed = packages;
+        return result;
+    }
+
+    std::deque<std::string> tail;
+    InstallProgress progress;
+    double shown = 0;
+    Process::LineSplitter lines([&](const std::string &line) {
+        if (parseInstallProgress(line, progress)) {
+            // Per-file percentages restart at 0; the bar should only move forward.
+            shown = progress.fraction = std::max(progress.fraction, shown);
+            if (onProgress) onProgress(progress);
+            return;
+        }
+        tail.push_back(stripEscapes(line));
+        if (tail.size() > kOutputLines) tail.pop_front();
+    });
+    result.exit_code = Process::runInPty(installCommand(config, packages), [&](const std::string &chunk) { lines.feed(chunk); });
+    lines.finish();
+    result.output.assign(tail.begin(), tail.end());
+
+    InstalledSet now = loadInstalled(config);
+    for (const std::string &package : packages) {
+        (isInstalled(package, config, now) ? result.installed : result.failed).push_back(package);
+    }
+    return result;
+}
+
+Prefetch::Prefetch(const Config &config, const std::vector<std::string> &packages) {
+    if (packages.empty() || config.prefetch_rate_kib <= 0) return;
+    std::vector<std::string> command;
+    if (geteuid() != 0) command = {"sudo", "-n"}; // never prompts; fails instead
+    if (isPacman(config)) {
+        command.insert(command.end(), {"pacman", "-Sw", "--needed", "--noconfirm"});
+        std::string limitedConfig = pacmanConfig("pacman-prefetch.conf", config.prefetch_rate_kib);
+        if (!limitedConfig.empty()) command.insert(command.end(), {"--config", limitedConfig});
+    } else if (isApt(config)) {
+        command.insert(command.end(), {"apt-get", "install", "--download-only", "-y", "-q",
+                                       "-o", "Acquire::http::Dl-Limit=" + std::to_string(config.prefetch_rate_kib),
+                                       "-o", "Acquire::https::Dl-Limit=" + std::to_string(config.prefetch_rate_kib)});
+    } else {
+        return;
+    }
+    command.insert(command.end(), packages.begin(), packages.end());
+    download = std::make_unique<Process::Background>(command);
+}
+
+} // namespace Packages
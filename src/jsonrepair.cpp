@@ -0,0 +1,181 @@
+#include "jsonrepair.hpp"
+#include <cctype>
+#include <cstring>
+#include <vector>
+
+namespace JsonRepair {
+
+namespace {
+
+// Returns the body of the first ``` fenced block, or text unchanged if there is none.
+std::string stripFences(const std::string &text) {
+    size_t open = text.find("```");
+    if (open == std::string::npos) return text;
+    size_t bodyStart = text.find('\n', open);
+    if (bodyStart == std::string::npos) return text;
+    size_t close = text.find("```", bodyStart);
+    return text.substr(bodyStart + 1, close == std::string::npos ? std::string::npos : close - bodyStart - 1);
+}
+
+struct Container {
+    char open;            // '[' or '{'
+    bool expectKey;       // objects only: the next string is a key
+    bool haveValue;       // a complete element was just emitted
+};
+
+// A place where the document can be cut and closed and still be valid.
+struct CutPoint {
+    size_t length = 0;
+    std::vector<Container> stack;
+};
+
+void trimTrailingComma(std::string &out) {
+    size_t end = out.find_last_not_of(" \t\r\n");
+    if (end != std::string::npos && out[end] == ',') out.erase(end);
+}
+
+void closeAll(std::string &out, const std::vector<Container> &stack) {
+    trimTrailingComma(out);
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        out += it->open == '[' ? ']' : '}';
+    }
+}
+
+} // namespace
+
+std::string repair(const std::string &text) {
+    std::string input = stripFences(text);
+    size_t start = input.find_first_of("[{");
+    if (start == std::string::npos) return input;
+
+    std::string out;
+    out.reserve(input.size() + 8);
+    std::vector<Container> stack;
+    CutPoint lastCut;
+    bool complete = false;
+
+    // Called whenever a value finishes; records a safe cut point.
+    auto valueDone = [&]() {
+        if (stack.empty()) {
+            complete = true;
+            return;
+        }
+        stack.back().haveValue = true;
+        if (stack.back().open == '{') stack.back().expectKey = true;
+        lastCut.length = out.size();
+        lastCut.stack = stack;
+    };
+    // Called before a value starts; inserts a comma the model forgot.
+    auto valueStart = [&]() {
+        if (!stack.empty() && stack.back().haveValue && stack.back().open == '[') {
+            out += ',';
+            stack.back().haveValue = false;
+        }
+    };
+
+    for (size_t i = start; i < input.size() && !complete; ++i) {
+        char c = input[i];
+        switch (c) {
+        case '"': {
+            bool isKey = !stack.empty() && stack.back().open == '{' && stack.back().expectKey;
+            if (isKey && stack.back().haveValue) {
+                out += ',';
+                stack.back().haveValue = false;
+            }
+            if (!isKey) valueStart();
+            std::string literal = "\"";
+            size_t j = i + 1;
+            bool closed = false;
+            for (; j < input.size(); ++j) {
+                char s = input[j];
+                if (s == '\\' && j + 1 < input.size()) {
+                    literal += s;
+                    literal += input[++j];
+                } else if (s == '"') {
+                    closed = true;
+                    break;
+                } else if (s == '\n') {
+                    literal += "\\n";
+                } else if (s == '\r') {
+                    literal += "\\r";
+                } else if (s == '\t') {
+                    literal += "\\t";
+                } else {
+                    literal += s;
+                }
+            }
+            if (!closed) {
+                i = input.size(); // Truncated inside a string.
+                break;
+            }
+            out += literal + "\"";
+            i = j;
+            if (isKey) {
+                stack.back().expectKey = false;
+            } else {
+                valueDone();
+            }
+            break;
+        }
+        case '{':
+        case '[':
+            valueStart();
+            out += c;
+            stack.push_back({c, c == '{', false});
+            break;
+        case '}':
+        case ']':
+            if (stack.empty()) break;
+            trimTrailingComma(out);
+            out += stack.back().open == '[' ? ']' : '}';
+            stack.pop_back();
+            valueDone();
+            break;
+        case ',':
+            if (!stack.empty()) {
+                if (stack.back().haveValue) {
+                    lastCut.length = out.size();
+                    lastCut.stack = stack;
+                }
+                if (stack.back().open == '{') stack.back().expectKey = true;
+                stack.back().haveValue = false;
+            }
+            out += c;
+            break;
+        case ':':
+            out += c;
+            break;
+        default:
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                out += c;
+            } else {
+                // Bare scalar (number, true, false, null): copy up to the next delimiter.
+                valueStart();
+                size_t j = i;
+                while (j < input.size() && !std::strchr(",]}: \t\r\n", input[j])) ++j;
+                if (j == input.size()) {
+                    i = j; // Truncated inside a scalar.
+                    break;
+                }
+                out.append(input, i, j - i);
+                i = j - 1;
+                valueDone();
+            }
+            break;
+        }
+    }
+
+    if (complete) return out;
+    // Truncated: keep everything up to the last complete value and close the rest.
+    out.resize(lastCut.length);
+    closeAll(out, lastCut.stack);
+    return out;
+}
+
+json parse(const std::string &text) {
+    json result = json::parse(text, nullptr, false);
+    if (!result.is_discarded()) return result;
+    return json::parse(repair(text), nullptr, false);
+}
+
+} // namespace JsonRepair
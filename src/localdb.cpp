@@ -0,0 +1,147 @@
+#include "localdb.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Packages {
+
+namespace {
+
+std::vector<std::string> descPaths(const std::string &dbRoot) {
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(dbRoot, error)) {
+        if (entry.is_directory(error)) paths.push_back((entry.path() / "desc").string());
+    }
+    return paths;
+}
+
+// Evicts the files from the page cache so the next read hits the disk. Only
+// clean pages are dropped, which is all a read-only database has.
+void dropCache(const std::vector<std::string> &paths) {
+    for (const std::string &path : paths) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+double timeMs(const std::function<void()> &run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+LocalPackage parseDesc(const std::string &desc) {
+    // Blocks of "%FIELD%\nvalue\nvalue\n\n".
+    LocalPackage package;
+    std::string field;
+    size_t pos = 0;
+    while (pos < desc.size()) {
+        size_t end = desc.find('\n', pos);
+        if (end == std::string::npos) end = desc.size();
+        std::string_view line(desc.data() + pos, end - pos);
+        pos = end + 1;
+
+        if (line.empty()) {
+            field.clear();
+        } else if (line.size() > 2 && line.front() == '%' && line.back() == '%') {
+            field = line.substr(1, line.size() - 2);
+        } else if (field == "NAME") {
+            package.name = line;
+        } else if (field == "VERSION") {
+            package.version = line;
+        } else if (field == "PROVIDES") {
+            package.provides.emplace_back(line.substr(0, line.find_first_of("=<>")));
+        }
+    }
+    return package;
+}
+
+LocalIndex LocalIndex::load(const std::string &dbRoot, BatchRead::Method method) {
+    LocalIndex index;
+    std::vector<std::string> paths = descPaths(dbRoot);
+    std::vector<std::string> descs = BatchRead::readFiles(paths, method);
+
+    index.packages.reserve(descs.size());
+    for (const std::string &desc : descs) {
+        LocalPackage package = parseDesc(desc);
+        if (!package.name.empty()) index.packages.push_back(std::move(package));
+    }
+    std::sort(index.packages.begin(), index.packages.end(),
+              [](const LocalPackage &a, const LocalPackage &b) { return a.name < b.name; });
+    for (size_t i = 0; i < index.packages.size(); ++i) {
+        for (const std::string &name : index.packages[i].provides) index.provided.emplace_back(name, i);
+    }
+    std::sort(index.provided.begin(), index.provided.end());
+    return index;
+}
+
+const LocalPackage *LocalIndex::find(const std::string &name) const {
+    auto it = std::lower_bound(packages.begin(), packages.end(), name,
+                               [](const LocalPackage &package, const std::string &key) { return package.name < key; });
+    return it != packages.end() && it->name == name ? &*it : nullptr;
+}
+
+bool LocalIndex::provides(const std::string &name) const {
+    if (find(name)) return true;
+    auto it = std::lower_bound(provided.begin(), provided.end(), std::make_pair(name, size_t(0)));
+    return it != provided.end() && it->first == name;
+}
+
+int benchmarkLocalIndex(const std::string &dbRoot) {
+    std::vector<std::string> paths = descPaths(dbRoot);
+    if (paths.empty()) {
+        std::cerr << "No package entries under " << dbRoot << "\n";
+        return 1;
+    }
+    std::cout << "Local database: " << dbRoot << " (" << paths.size() << " packages)\n";
+
+    size_t indexed = 0;
+    for (BatchRead::Method method : {BatchRead::Method::IoUring, BatchRead::Method::Threads}) {
+        BatchRead::Method used = method;
+        BatchRead::readFiles({}, method, &used);
+        const char *label = used == BatchRead::Method::IoUring ? "io_uring" : "threads";
+        if (used != method) {
+            std::cout << "  io_uring unavailable, skipped\n";
+            continue;
+        }
+
+        dropCache(paths);
+        double cold = timeMs([&]() { indexed = LocalIndex::load(dbRoot, method).packages.size(); });
+        std::vector<double> warm;
+        for (int run = 0; run < 5; ++run) warm.push_back(timeMs([&]() { LocalIndex::load(dbRoot, method); }));
+        std::sort(warm.begin(), warm.end());
+        std::cout << "  index via " << label << ": cold " << cold << " ms, warm " << warm[warm.size() / 2] << " ms\n";
+    }
+
+    // The previous approach: one "pacman -Qi" spawn per package checked.
+    if (dbRoot == kPacmanLocalDb && checkDependency("pacman")) {
+        LocalIndex index = LocalIndex::load(dbRoot);
+        size_t sample = std::min<size_t>(20, index.packages.size());
+        double total = timeMs([&]() {
+            for (size_t i = 0; i < sample; ++i) {
+                std::string command = "pacman -Qi " + index.packages[i].name + " > /dev/null 2>&1";
+                (void)system(command.c_str());
+            }
+        });
+        std::cout << "  pacman -Qi: " << total / sample << " ms per package, ~"
+                  << static_cast<long>(total / sample * index.packages.size()) << " ms for all " << index.packages.size() << "\n";
+    } else {
+        std::cout << "  pacman -Qi: skipped (needs pacman and the system database)\n";
+    }
+    std::cout << "  " << indexed << " packages indexed\n";
+    return 0;
+}
+
+} // namespace Packages
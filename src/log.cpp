@@ -0,0 +1,256 @@
+#include "log.hpp"
+#include "utils.hpp"
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <sys/stat.h>
+
+namespace Log {
+
+namespace {
+
+const size_t kCapacity = 1024; // records; a power of two
+const long kRotateBytes = 4 << 20;
+
+struct Record {
+    std::chrono::system_clock::time_point time;
+    Level level = Level::Info;
+    const char *message = "";
+    std::vector<Field> fields;
+};
+
+// Bounded multi-producer queue (Vyukov): each slot's sequence number says
+// whether it is free for the producer at that position or holds a record for
+// the consumer. Producers claim positions with a CAS; there is one consumer.
+class Ring {
+public:
+    Ring() {
+        for (size_t i = 0; i < kCapacity; ++i) slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(Record &&record) {
+        size_t position = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = slots[position & (kCapacity - 1)];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.record = std::move(record);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false; // full
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(Record &record) {
+        Slot &slot = slots[tail & (kCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != tail + 1) return false;
+        record = std::move(slot.record);
+        slot.sequence.store(tail + kCapacity, std::memory_order_release);
+        ++tail;
+        return true;
+    }
+
+    // Positions handed out so far; everything up to here is in the file once
+    // written reaches it.
+    size_t claimed() const { return head.load(std::memory_order_acquire); }
+    std::atomic<size_t> written{0};
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        Record record;
+    };
+    Slot slots[kCapacity];
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) size_t tail = 0;
+};
+
+const char *levelName(Level level) {
+    static const char *names[] = {"trace", "debug", "info", "warn", "error", "off"};
+    return names[static_cast<int>(level)];
+}
+
+Level levelFromEnvironment() {
+    const char *value = std::getenv("SYSIQ_LOG");
+    std::string name = value ? value : "";
+    for (int level = 0; level <= static_cast<int>(Level::Off); ++level) {
+        if (name == levelName(static_cast<Level>(level))) return static_cast<Level>(level);
+    }
+    return Level::Info;
+}
+
+// Masks the value after each marker (query parameters, header values) up to
+// a delimiter.
+void maskAfter(std::string &text, const std::string &marker, const char *delimiters) {
+    for (size_t at = 0; (at = text.find(marker, at)) != std::string::npos;) {
+        size_t begin = at + marker.size();
+        size_t end = text.find_first_of(delimiters, begin);
+        if (end == std::string::npos) end = text.size();
+        if (end > begin) text.replace(begin, end - begin, "[redacted]");
+        at = begin;
+    }
+}
+
+bool sensitiveName(const std::string &name) {
+    std::string lower;
+    for (char c : name) lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    for (const char *word : {"key", "token", "secret", "password", "authorization"}) {
+        if (lower.find(word) != std::string::npos) return true;
+    }
+    return false;
+}
+
+class Logger {
+public:
+    ~Logger() {
+        if (!worker.joinable()) return;
+        stopping = true;
+        worker.join();
+    }
+
+    std::atomic<int> threshold{static_cast<int>(levelFromEnvironment())};
+    std::atomic<size_t> dropped{0};
+    Ring ring;
+
+    void setFile(const std::string &file) {
+        std::lock_guard<std::mutex> lock(setup);
+        path = file;
+    }
+
+    void addSecret(const std::string &secret) {
+        if (secret.size() < 4) return; // too short to mask without mangling text
+        std::lock_guard<std::mutex> lock(setup);
+        secrets.push_back(secret);
+    }
+
+    void start() {
+        std::call_once(started, [this]() { worker = std::thread([this]() { run(); }); });
+    }
+
+private:
+    std::mutex setup; // path and secrets; rare, and never on the ring's path
+    std::string path;
+    std::vector<std::string> secrets;
+    std::once_flag started;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+
+    std::string redact(std::string text) {
+        {
+            std::lock_guard<std::mutex> lock(setup);
+            for (const std::string &secret : secrets) {
+                for (size_t at; (at = text.find(secret)) != std::string::npos;) text.replace(at, secret.size(), "[redacted]");
+            }
+        }
+        for (const char *parameter : {"key=", "token=", "secret=", "password="}) maskAfter(text, parameter, "&\"' \n");
+        for (const char *header : {"Authorization: ", "x-goog-api-key: ", "x-api-key: "}) maskAfter(text, header, "\"\n");
+        return text;
+    }
+
+    nlohmann::json redactValue(const std::string &name, nlohmann::json value) {
+        if (sensitiveName(name) && value.is_string()) return "[redacted]"; // counts like "prompt_tokens" stay
+        if (value.is_string()) return redact(value.get<std::string>());
+        if (value.is_structured()) return redact(value.dump()); // nested payloads are logged as text
+        return value;
+    }
+
+    std::string format(const Record &record) {
+        std::time_t seconds = std::chrono::system_clock::to_time_t(record.time);
+        long millis = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                            record.time.time_since_epoch()).count() % 1000);
+        std::tm utc = {};
+        gmtime_r(&seconds, &utc);
+        char stamp[40];
+        size_t length = std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+        std::snprintf(stamp + length, sizeof(stamp) - length, ".%03ldZ", millis);
+        nlohmann::ordered_json line = {{"time", stamp}, {"level", levelName(record.level)}, {"msg", record.message}};
+        for (const Field &field : record.fields) line[field.key] = redactValue(field.key, field.value);
+        return line.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + "\n";
+    }
+
+    std::FILE *open() {
+        std::string file;
+        {
+            std::lock_guard<std::mutex> lock(setup);
+            file = path.empty() ? cachePath("sysiq.log") : path;
+        }
+        struct stat info;
+        if (stat(file.c_str(), &info) == 0 && info.st_size > kRotateBytes) std::rename(file.c_str(), (file + ".1").c_str());
+        return std::fopen(file.c_str(), "a");
+    }
+
+    void run() {
+        std::FILE *out = open();
+        Record record;
+        size_t done = 0;
+        for (;;) {
+            bool any = false;
+            while (ring.pop(record)) {
+                if (out) std::fputs(format(record).c_str(), out);
+                record.fields.clear();
+                ++done;
+                any = true;
+            }
+            if (size_t lost = dropped.exchange(0)) {
+                if (out) std::fprintf(out, "{\"level\":\"warn\",\"msg\":\"log ring full\",\"dropped\":%zu}\n", lost);
+            }
+            if (!any) {
+                if (out) std::fflush(out);
+                ring.written.store(done, std::memory_order_release);
+                if (stopping) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+        }
+        if (out) std::fclose(out);
+    }
+};
+
+Logger &logger() {
+    static Logger instance;
+    return instance;
+}
+
+} // namespace
+
+bool enabled(Level level) {
+    return static_cast<int>(level) >= logger().threshold.load(std::memory_order_relaxed);
+}
+
+void setLevel(Level level) { logger().threshold.store(static_cast<int>(level), std::memory_order_relaxed); }
+
+void setFile(const std::string &path) { logger().setFile(path); }
+
+void addSecret(const std::string &secret) { logger().addSecret(secret); }
+
+void write(Level level, const char *message, std::vector<Field> fields) {
+    Logger &log = logger();
+    log.start();
+    Record record;
+    record.time = std::chrono::system_clock::now();
+    record.level = level;
+    record.message = message;
+    record.fields = std::move(fields);
+    if (!log.ring.push(std::move(record))) log.dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void flush() {
+    Logger &log = logger();
+    size_t target = log.ring.claimed(); // dropped records never claim a position
+    while (log.ring.written.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+} // namespace Log
@@ -2,178 +2,406 @@
 #include <string>
 #include <sstream>
 #include <vector>
-#include <curl/curl.h>
 #include "ai.hpp"
 #include "config.hpp"
+#include "executor.hpp"
+#include "packages.hpp"
+#include "localdb.hpp"
+#include "commandindex.hpp"
+#include "install.hpp"
+#include "process.hpp"
+#include "terminal.hpp"
+#include "log.hpp"
+#include "output.hpp"
+#include "sysiq.hpp"
+#include "preview.hpp"
+#include "outputcache.hpp"
+#include "startup.hpp"
+#include "builtins.hpp"
+#include "batch.hpp"
+#include "batchjob.hpp"
+#include "session.hpp"
+#include "stats.hpp"
+#include "utils.hpp"
 #include "json.hpp"
 #include <filesystem>
+#include <cstdio>
 #include <cstdlib>
 #include <algorithm>
 #include <stdexcept>
-#include <thread>     // Required for std::this_thread::sleep_for
 #include <chrono>     // Required for std::chrono
+#include <fstream>
+#include <memory>
+#include <ctime>
+#include <optional>
 
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
-// ANSI escape codes for colors and formatting (as before)
-#define ANSI_COLOR_GREEN   "\x1b[32m"
-#define ANSI_COLOR_YELLOW  "\x1b[33m"
-#define ANSI_COLOR_RED     "\x1b[31m"
-#define ANSI_COLOR_BOLD    "\x1b[1m"
-#define ANSI_COLOR_RESET   "\x1b[0m"
+// ANSI escape codes for colors and formatting; empty when stdout is not a terminal.
+#define ANSI_COLOR_GREEN   Terminal::style("\x1b[32m")
+#define ANSI_COLOR_YELLOW  Terminal::style("\x1b[33m")
+#define ANSI_COLOR_RED     Terminal::style("\x1b[31m")
+#define ANSI_COLOR_BOLD    Terminal::style("\x1b[1m")
+#define ANSI_COLOR_RESET   Terminal::style("\x1b[0m")
 
-// Helper function for sleep/delay
-void sleep_ms(int milliseconds) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
-}
+// Installs the packages in one package-manager transaction, drawing its real
+// progress. Returns the packages that did not end up installed.
+std::vector<std::string> installPackages(const Config& config, const std::vector<std::string>& packages) {
+    std::string names;
+    for (const std::string &package : packages) names += " " + package;
+    std::cout << ANSI_COLOR_GREEN << ANSI_COLOR_BOLD << "Installing:" << ANSI_COLOR_RESET << ANSI_COLOR_GREEN << names << ANSI_COLOR_RESET << std::endl;
 
-// Function to display a simple progress bar (modified for smoother animation)
-void showProgressBar(float progress, const std::string& message) {
-    int barWidth = 50;
-    int pos = barWidth * progress;
-    std::cout << ANSI_COLOR_YELLOW << message << " [" << ANSI_COLOR_RESET;
-    for (int i = 0; i < barWidth; ++i) {
-        if (i < pos) std::cout << ANSI_COLOR_GREEN << "=" << ANSI_COLOR_RESET;
-        else std::cout << " ";
-    }
-    int percentage = static_cast<int>(progress * 100.0); // Calculate percentage once
-    std::cout << ANSI_COLOR_YELLOW << "] " << ANSI_COLOR_RESET << percentage << "%\r";
-    std::cout.flush();
-}
+    Terminal::Renderer bar;
+    Packages::InstallResult result = Packages::install(config, packages, [&bar](const Packages::InstallProgress &progress) {
+        std::string stage = progress.stage;
+        stage.resize(12, ' '); // fixed width so the bar doesn't jump between stages
+        bar.draw({Terminal::progressBar(progress.fraction, "Installing: " + stage)});
+    });
+    bar.finish();
 
-// Function to clear the terminal screen (as before)
-void clearScreen() {
-    std::cout << "\033[2J\033[H"; // ANSI escape sequence to clear screen and move cursor to top-left
+    if (result.failed.empty()) {
+        std::cout << ANSI_COLOR_GREEN << ANSI_COLOR_BOLD << "Installation successful!" << ANSI_COLOR_RESET << std::endl;
+    } else {
+        for (const std::string &line : result.output) std::cerr << line << std::endl;
+        std::string failed;
+        for (const std::string &package : result.failed) failed += " " + package;
+        std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Installation failed (exit code " << result.exit_code << "):" << failed << ANSI_COLOR_RESET << std::endl;
+    }
+    return result.failed;
 }
 
-// Function to check if a package is installed (as before - no changes)
-bool isPackageInstalled(const std::string& package, const Config& config) {
-    std::string command = config.package_manager + " -Qi " + package + " > /dev/null 2>&1";
-    return (system(command.c_str()) == 0);
+// One-line summary of how a command ended and what it cost.
+std::string describeUsage(const Process::Usage &usage) {
+    char line[160];
+    if (usage.exit_code < 0) return "(could not start the command)";
+    std::snprintf(line, sizeof(line), "(exit %d, %.2f s, CPU %.2f s user + %.2f s system, peak RSS %.1f MiB)",
+                  usage.exit_code, usage.wall_ms / 1000, usage.user_ms / 1000, usage.system_ms / 1000, usage.peak_rss_kib / 1024.0);
+    return line;
 }
 
-// Function to install a package (modified progress bar animation and delays)
-std::string installPackage(const Config& config, const std::string& package) {
-    std::string installCommand = "sudo " + config.package_manager + " -S " + package;
-    std::cout << ANSI_COLOR_GREEN << ANSI_COLOR_BOLD << "Executing install command: " << ANSI_COLOR_RESET << ANSI_COLOR_GREEN << installCommand << ANSI_COLOR_RESET << std::endl;
-
-    // Simulate installation with progress bar (more steps, longer delay)
-    for (float progress = 0.0; progress <= 1.0; progress += 0.1) { // Increased steps for smoother bar
-        showProgressBar(progress, "Installing"); // Added message to progress bar
-        sleep_ms(200); // Longer delay to make progress visible
-    }
-    std::cout << std::endl; // Newline after progress bar
-
-    int exit_code = system(installCommand.c_str());
-    if(exit_code == 0) {
-        std::cout << ANSI_COLOR_GREEN << ANSI_COLOR_BOLD << "Installation successful!" << ANSI_COLOR_RESET << std::endl;
-        return "Installation successful";
-    } else {
-        std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Installation failed!" << ANSI_COLOR_RESET << std::endl;
-        return "Installation failed";
-    }
+void printUsage(const char *program) {
+    std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Usage: " << ANSI_COLOR_RESET << program << " [--ai] <user_query>" << std::endl;
+    std::cerr << "       " << program << " --batch <file|->   (one query per line, JSON lines out)" << std::endl;
+    std::cerr << "       " << program << " --session <name> <user_query>   (follow-ups reuse the conversation)" << std::endl;
+    std::cerr << "       " << program << " --end-session <name>" << std::endl;
+    std::cerr << "       " << program << " --batch-job <corpus> <output.jsonl> [--job-state <file>] [--poll <seconds>]" << std::endl;
+    std::cerr << "       " << program << " --output json|jsonl|cbor|msgpack [--batch <file|->] <user_query>   (no prompts)" << std::endl;
 }
 
+// Milliseconds since start.
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
 int main(int argc, char *argv[]) {
+    auto startTime = std::chrono::steady_clock::now();
     if (argc < 2) {
-        std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Usage: " << ANSI_COLOR_RESET << argv[0] << " <user_query>" << std::endl;
+        printUsage(argv[0]);
         return 1;
     }
 
-    // Load the configuration
-    Config config = Config::load();
-    config.save("/home/xyz/.config/sysiq/config.json");
+    std::string firstArg = argv[1];
+    if (firstArg == "--measure-startup") return measureStartup();
+    if (firstArg == "--startup-probe") return startupProbe(false);
+    if (firstArg == "--startup-probe=net") return startupProbe(true);
+    if (firstArg == "--bench-installed") {
+        return Packages::benchmarkLocalIndex(argc > 2 ? argv[2] : Packages::kPacmanLocalDb);
+    }
+    if (firstArg == "--tier-stats") {
+        LatencyStats::load(cachePath("tiers.json")).print();
+        return 0;
+    }
 
-    // Get the API key from the environment variables:
-    const char* apiKey = std::getenv("GEMINI_API_KEY");
-    if (apiKey == nullptr) {
-        std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Error: GEMINI_API_KEY environment variable not set." << ANSI_COLOR_RESET << std::endl;
+    // Leading options; everything after them is the query.
+    bool forceAI = false;     // "--ai" skips the built-in handlers and always asks the model.
+    std::string batchFile;    // "--batch" answers a file of queries with packed requests.
+    AI::BatchJobOptions batchJob; // "--batch-job" runs a corpus through the Gemini Batch API.
+    std::string sessionName;  // "--session" answers in the context of earlier questions.
+    Output::Format outputFormat = Output::Format::Text; // "--output" prints the result for programs, no menu.
+    int queryStart = 1;
+    for (; queryStart < argc; ++queryStart) {
+        std::string arg = argv[queryStart];
+        if (arg == "--ai") {
+            forceAI = true;
+        } else if (arg == "--batch" && queryStart + 1 < argc) {
+            batchFile = argv[++queryStart];
+        } else if (arg == "--batch-job" && queryStart + 2 < argc) {
+            batchJob.corpus_path = argv[++queryStart];
+            batchJob.output_path = argv[++queryStart];
+        } else if (arg == "--job-state" && queryStart + 1 < argc) {
+            batchJob.state_path = argv[++queryStart];
+        } else if (arg == "--session" && queryStart + 1 < argc) {
+            sessionName = argv[++queryStart];
+        } else if (arg == "--end-session" && queryStart + 1 < argc) {
+            std::remove(AI::Session::load(argv[queryStart + 1]).path.c_str());
+            return 0;
+        } else if (arg == "--output" && queryStart + 1 < argc) {
+            if (!Output::parseFormat(argv[++queryStart], outputFormat)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--poll" && queryStart + 1 < argc) {
+            batchJob.initial_poll_seconds = std::atof(argv[++queryStart]);
+        } else {
+            break;
+        }
+    }
+    bool bulkMode = !batchFile.empty() || !batchJob.corpus_path.empty();
+    bool machineOutput = outputFormat != Output::Format::Text;
+    if (queryStart >= argc && !bulkMode) {
+        printUsage(argv[0]);
         return 1;
     }
-    std::string apiKeyStr(apiKey);
 
     // Concatenate command line arguments into a single user query string
     std::stringstream ss;
-    for (int i = 1; i < argc; ++i) {
+    for (int i = queryStart; i < argc; ++i) {
         ss << argv[i] << (i == argc - 1 ? "" : " ");
     }
     std::string userQuery = ss.str();
 
-    // Create a JSON object to hold the configuration data
-    json sysInfo = {
-      {"distro", config.distro},
-      {"desktop", config.desktop},
-      {"shell", config.shell},
-      {"terminal", config.terminal}
+    // Common informational queries are answered natively, without the API.
+    // Programs asking for --output want a package list, so they always get one.
+    if (!forceAI && !bulkMode && sessionName.empty() && !machineOutput) {
+        if (const Builtins::Handler *handler = Builtins::match(userQuery)) {
+            std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "--- " << handler->name << " ---" << ANSI_COLOR_RESET << std::endl;
+            std::cout << handler->run();
+            return 0;
+        }
+    }
+
+    // Startup task graph. Only config -> context probes -> API query -> display
+    // is serial (the prompt carries the probe results, so the probes run at the
+    // start of the query job); the preconnect and the package index loads run
+    // alongside it.
+    Executor executor(SysIQ::kWarmupJobs + 1); // the warm-ups, plus the query job
+
+    // Programs asking for --output get an error document instead of the
+    // interactive setup (or a message they cannot parse).
+    auto machineError = [&](const std::string &error) {
+        SysIQ::Result failed;
+        failed.query = userQuery;
+        failed.error = error;
+        Output::write(outputFormat, SysIQ::toJson(failed));
+        return 1;
     };
 
-    clearScreen(); // Clear screen before AI query
-    for (float progress = 0.1f; progress <= 1.0f; progress += 0.1f) { // Progress bar during AI query
-        showProgressBar(progress, "Querying AI for Packages");
-        sleep_ms(50); // Delay for AI thinking progress
+    // Load the configuration
+    const std::string configPath = "/home/xyz/.config/sysiq/config.json";
+    Config config;
+    if (machineOutput) {
+        std::string error;
+        std::optional<Config> stored = Config::read(configPath, &error);
+        if (!stored) return machineError("no usable configuration: " + error);
+        config = *stored;
+    } else {
+        config = Config::load(configPath);
+        config.save(configPath);
+    }
+
+    // Get the API key from the environment variables (local providers don't need one):
+    const char* apiKey = std::getenv("GEMINI_API_KEY");
+    if (apiKey == nullptr && AI::requiresGeminiKey(config)) {
+        if (machineOutput) return machineError("GEMINI_API_KEY environment variable not set");
+        std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Error: GEMINI_API_KEY environment variable not set." << ANSI_COLOR_RESET << std::endl;
+        return 1;
+    }
+    std::string apiKeyStr(apiKey ? apiKey : "");
+
+    std::future<void> warmConnection; // the client warms its own connection
+    if (bulkMode) warmConnection = executor.submit([&config]() { AI::preconnect(config); });
+
+    if (!batchJob.corpus_path.empty()) {
+        if (batchJob.state_path.empty()) batchJob.state_path = batchJob.output_path + ".state.json";
+        return AI::runBatchJob(config, batchJob, apiKeyStr) ? 0 : 1;
     }
-    std::cout << std::endl; // Newline after progress bar
-    //std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "\n--- Querying AI for Packages ---" << ANSI_COLOR_RESET << std::endl;
-    showProgressBar(0.0f, "Thinking"); // Start progress bar at 0%
 
-    AI::PackageListResponse packageListResponse = AI::queryPackageList(config, sysInfo, userQuery, apiKeyStr);
+    if (!batchFile.empty()) {
+        std::ifstream file;
+        if (batchFile != "-") file.open(batchFile);
+        std::istream &in = batchFile == "-" ? std::cin : file;
+        if (!in) {
+            std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Cannot read " << batchFile << ANSI_COLOR_RESET << std::endl;
+            return 1;
+        }
+        std::vector<std::string> queries;
+        for (std::string line; std::getline(in, line);) {
+            if (!line.empty()) queries.push_back(line);
+        }
+        std::vector<AI::PackageListResponse> results = AI::queryPackageLists(config, queries, apiKeyStr);
+        std::vector<json> documents;
+        for (size_t i = 0; i < results.size(); ++i) {
+            json line = AI::toJson(results[i]);
+            line["query"] = queries[i];
+            documents.push_back(line);
+        }
+        Output::writeAll(machineOutput ? outputFormat : Output::Format::JsonLines, documents);
+        return 0;
+    }
+    // The library does the work (context probes, the model ladder, name and
+    // status checks); the package indexes start loading now, alongside it.
+    SysIQ::Client client(config, apiKeyStr, SysIQ::scheduleOn(executor));
+    SysIQ::QueryOptions options;
+    options.session = sessionName;
+    std::future<SysIQ::Result> resultFuture = client.query(userQuery, options);
 
-    for (float progress = 0.1f; progress <= 1.0f; progress += 0.1f) { // Progress bar during AI query
-        showProgressBar(progress, "Thinking");
-        sleep_ms(100); // Delay for AI thinking progress
+    // Animate while the request is in flight instead of adding fixed delays around it.
+    Terminal::Renderer bar;
+    double progress = 0.0;
+    while (!machineOutput && resultFuture.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready) {
+        bar.draw({Terminal::progressBar(progress, "Querying AI for Packages")});
+        progress = std::min(progress + 0.05, 0.9);
     }
-    std::cout << std::endl; // Newline after progress bar
-    clearScreen(); // Clear screen after AI response
+    bar.erase();
+
+    SysIQ::Result result = resultFuture.get();
 
+    if (machineOutput) {
+        json document = SysIQ::toJson(result);
+        document["timings_ms"]["total"] = elapsedMs(startTime);
+        Output::write(outputFormat, document);
+        return result.error.empty() ? 0 : 1;
+    }
 
-    if (packageListResponse.packages.empty()) {
-        std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Failed to get the list of required packages." << ANSI_COLOR_RESET << std::endl;
+    if (!result.error.empty()) {
+        std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Failed to get the list of required packages." << ANSI_COLOR_RESET
+                  << " Details are in " << cachePath("sysiq.log") << std::endl;
         return 1;
     }
 
-    // 2. Display packages to user and handle installation (as before, but with delay)
+    const std::vector<SysIQ::Suggestion> &suggestions = result.suggestions;
+    for (const SysIQ::Suggestion &suggestion : suggestions) {
+        if (suggestion.suggested_name.empty()) continue;
+        std::cout << ANSI_COLOR_YELLOW << "Corrected package name " << suggestion.suggested_name << " -> " << suggestion.package_name << ANSI_COLOR_RESET << std::endl;
+    }
+
+    // 2. Display packages to user and handle installation
     std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "\n--- Choose Package ---" << ANSI_COLOR_RESET << std::endl;
-    for (size_t i = 0; i < packageListResponse.packages.size(); ++i) {
-        std::string installedStatus = isPackageInstalled(packageListResponse.packages[i].package_name, config) ? std::string(ANSI_COLOR_GREEN) + "[Installed]" + ANSI_COLOR_RESET : std::string(ANSI_COLOR_RED) + "[Not Installed]" + ANSI_COLOR_RESET;
+    for (size_t i = 0; i < suggestions.size(); ++i) {
+        std::string installedLabel = suggestions[i].installed ? std::string(ANSI_COLOR_GREEN) + "[Installed]" + ANSI_COLOR_RESET
+                                     : suggestions[i].known   ? std::string(ANSI_COLOR_RED) + "[Not Installed]" + ANSI_COLOR_RESET
+                                                        : std::string(ANSI_COLOR_RED) + "[Unknown Package]" + ANSI_COLOR_RESET;
+        if (!suggestions[i].provided_by.empty()) {
+            installedLabel += std::string(" ") + ANSI_COLOR_YELLOW + "[" + Packages::commandProgram(suggestions[i].command) +
+                              " is provided by " + suggestions[i].provided_by + "]" + ANSI_COLOR_RESET;
+        }
         std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << i + 1 << ". " << ANSI_COLOR_RESET
-                  << packageListResponse.packages[i].package_name << " - Command: " << packageListResponse.packages[i].command << " " << installedStatus << std::endl;
-         sleep_ms(50); // Small delay between package list items
-    }
-
-    int choice;
-    std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "Select a package number to use (or 0 to skip): " << ANSI_COLOR_RESET;
-    std::cin >> choice;
-
-    if (choice > 0 && choice <= packageListResponse.packages.size()) {
-        AI::PackageInfo selectedPackage = packageListResponse.packages[choice - 1];
-        if (!isPackageInstalled(selectedPackage.package_name, config)) {
-            char installChoice;
-            std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "Package '" << selectedPackage.package_name << "' is not installed. Install now? (y/N): " << ANSI_COLOR_RESET;
-            std::cin >> installChoice;
-            if (installChoice == 'y' || installChoice == 'Y') {
-                installPackage(config, selectedPackage.package_name);
-            } else {
-                std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "Installation skipped." << ANSI_COLOR_RESET << std::endl;
-                return 0; // Exit if installation skipped
-            }
+                  << suggestions[i].package_name << " - Command: " << suggestions[i].command << " " << installedLabel << std::endl;
+    }
+
+    // The network is idle while the user reads the menu: start downloading the
+    // suggestions that would need installing.
+    std::vector<std::string> prefetchable;
+    for (size_t i = 0; i < suggestions.size(); ++i) {
+        const std::string &name = suggestions[i].package_name;
+        if (!suggestions[i].installed && suggestions[i].known && std::find(prefetchable.begin(), prefetchable.end(), name) == prefetchable.end()) {
+            prefetchable.push_back(name);
         }
+    }
+    // Ctrl-C at the menu must not leave the download (holding the package
+    // manager's lock) or the previews running.
+    Process::killTrackedOnSignal();
+    Packages::Prefetch prefetch(config, prefetchable);
 
-        // 3. Execute the command for the chosen package
-        clearScreen(); // Clear screen before command execution
-        std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "\n--- Executing Command ---" << ANSI_COLOR_RESET << std::endl;
-        std::cout << ANSI_COLOR_GREEN << ANSI_COLOR_BOLD << "Executing command: " << ANSI_COLOR_RESET << ANSI_COLOR_GREEN << selectedPackage.command << ANSI_COLOR_RESET << std::endl;
-        system(selectedPackage.command.c_str());
+    // Read-only commands that can already run are started in a sandbox while
+    // the user decides, unless a recent run's output is still valid; a chosen
+    // one then shows its output immediately.
+    const size_t kMaxPreviews = 3;
+    std::string outputsPath = cachePath("outputs.json");
+    Preview::OutputCache outputs = Preview::OutputCache::load(outputsPath);
+    std::vector<std::optional<Preview::OutputCache::Entry>> cached(suggestions.size());
+    std::vector<std::unique_ptr<Preview::Run>> previews(suggestions.size());
+    for (size_t i = 0, started = 0; i < previews.size() && started < kMaxPreviews; ++i) {
+        if (!suggestions[i].installed || !Preview::isReadOnly(suggestions[i].command)) continue;
+        if (const Preview::OutputCache::Entry *entry = outputs.find(suggestions[i].command)) cached[i] = *entry;
+        if (cached[i] || !Preview::canPreview(suggestions[i].command)) continue;
+        previews[i] = std::make_unique<Preview::Run>(suggestions[i].command);
+        ++started;
+    }
 
+    std::string selection;
+    std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "Select package numbers to use, e.g. 1 or 1 3 (or 0 to skip): " << ANSI_COLOR_RESET;
+    std::getline(std::cin, selection);
+    prefetch.cancel(); // partial downloads stay in the cache and are resumed by the install
 
-    } else if (choice != 0) {
-        std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Invalid choice." << ANSI_COLOR_RESET << std::endl;
-        return 1;
-    } else {
+    std::replace(selection.begin(), selection.end(), ',', ' ');
+    std::stringstream numbers(selection);
+    std::vector<size_t> chosen;
+    for (std::string token; numbers >> token;) {
+        char *end = nullptr;
+        long number = std::strtol(token.c_str(), &end, 10);
+        if (*end != '\0' || number < 0 || number > static_cast<long>(suggestions.size())) {
+            std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Invalid choice." << ANSI_COLOR_RESET << std::endl;
+            return 1;
+        }
+        if (number > 0 && std::find(chosen.begin(), chosen.end(), number - 1) == chosen.end()) chosen.push_back(number - 1);
+    }
+    for (size_t i = 0; i < previews.size(); ++i) {
+        if (previews[i] && std::find(chosen.begin(), chosen.end(), i) == chosen.end()) previews[i]->cancel();
+    }
+    if (chosen.empty()) {
         std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "Skipping package selection and command execution." << ANSI_COLOR_RESET << std::endl;
+        return 0;
+    }
+
+    // Everything selected that is missing goes into a single transaction.
+    std::vector<std::string> toInstall;
+    for (size_t index : chosen) {
+        const SysIQ::Suggestion &package = suggestions[index];
+        if (suggestions[index].installed) continue;
+        if (!suggestions[index].known) {
+            std::cerr << ANSI_COLOR_RED << ANSI_COLOR_BOLD << "Package '" << package.package_name << "' was not found in the repositories." << ANSI_COLOR_RESET << std::endl;
+            return 1;
+        }
+        if (std::find(toInstall.begin(), toInstall.end(), package.package_name) == toInstall.end()) toInstall.push_back(package.package_name);
+    }
+    std::vector<std::string> failed;
+    if (!toInstall.empty()) {
+        std::string names;
+        for (const std::string &name : toInstall) names += (names.empty() ? "" : ", ") + name;
+        std::string installChoice;
+        std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "Not installed: " << names << ". Install now? (y/N): " << ANSI_COLOR_RESET;
+        std::getline(std::cin, installChoice);
+        if (installChoice != "y" && installChoice != "Y") {
+            std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "Installation skipped." << ANSI_COLOR_RESET << std::endl;
+            return 0; // Exit if installation skipped
+        }
+        failed = installPackages(config, toInstall);
+        if (failed.size() == toInstall.size()) return 1;
     }
 
+    // 3. Execute the commands for the chosen packages
+    std::cout << ANSI_COLOR_YELLOW << ANSI_COLOR_BOLD << "\n--- Executing Command ---" << ANSI_COLOR_RESET << std::endl;
+    for (size_t index : chosen) {
+        const SysIQ::Suggestion &selectedPackage = suggestions[index];
+        if (std::find(failed.begin(), failed.end(), selectedPackage.package_name) != failed.end()) continue;
+        std::cout << ANSI_COLOR_GREEN << ANSI_COLOR_BOLD << "Executing command: " << ANSI_COLOR_RESET << ANSI_COLOR_GREEN << selectedPackage.command << ANSI_COLOR_RESET << std::endl;
+        if (cached[index]) {
+            std::cout << cached[index]->output;
+            std::cout << ANSI_COLOR_YELLOW << "(output from " << std::time(nullptr) - cached[index]->stored_at << "s ago)" << ANSI_COLOR_RESET << std::endl;
+            continue;
+        }
+        if (previews[index]) {
+            Preview::Result preview = previews[index]->wait();
+            // A failure may be the sandbox's doing (a denied read), so only a
+            // clean exit stands in for the real run.
+            if (preview.sandboxed && preview.complete && preview.exit_code == 0) {
+                std::cout << preview.output << std::flush;
+                if (outputs.store(selectedPackage.command, preview)) outputs.save(outputsPath);
+                continue;
+            }
+        }
+        std::vector<std::string> shellArgv = Process::shellCommand(config.shell, selectedPackage.command);
+        if (config.exec_in_place && index == chosen.back()) {
+            previews.clear(); // reap the sandboxed runs; their threads vanish with exec
+            std::cout << std::flush;
+            Log::flush();
+            Process::execInPlace(shellArgv);
+        }
+        Process::Usage usage = Process::runAttached(shellArgv);
+        std::cout << ANSI_COLOR_YELLOW << describeUsage(usage) << ANSI_COLOR_RESET << std::endl;
+    }
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include "output.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+
+namespace Output {
+
+namespace {
+
+void writeBytes(const std::vector<std::uint8_t> &bytes) {
+    std::fwrite(bytes.data(), 1, bytes.size(), stdout);
+}
+
+} // namespace
+
+bool parseFormat(const std::string &name, Format &format) {
+    if (name == "json") format = Format::Json;
+    else if (name == "jsonl") format = Format::JsonLines;
+    else if (name == "cbor") format = Format::Cbor;
+    else if (name == "msgpack") format = Format::MessagePack;
+    else return false;
+    return true;
+}
+
+void write(Format format, const nlohmann::json &document) {
+    std::cout.flush(); // keep ordering with anything still buffered
+    // Invalid UTF-8 from a package database or model reply must not abort the dump.
+    const auto replace = nlohmann::json::error_handler_t::replace;
+    switch (format) {
+    case Format::Text:
+    case Format::Json:
+        std::fputs((document.dump(2, ' ', false, replace) + "\n").c_str(), stdout);
+        break;
+    case Format::JsonLines:
+        std::fputs((document.dump(-1, ' ', false, replace) + "\n").c_str(), stdout);
+        break;
+    case Format::Cbor:
+        writeBytes(nlohmann::json::to_cbor(document));
+        break;
+    case Format::MessagePack:
+        writeBytes(nlohmann::json::to_msgpack(document));
+        break;
+    }
+    std::fflush(stdout);
+}
+
+void writeAll(Format format, const std::vector<nlohmann::json> &documents) {
+    if (format == Format::Json) {
+        write(format, nlohmann::json(documents));
+        return;
+    }
+    for (const nlohmann::json &document : documents) write(format, document);
+}
+
+} // namespace Output
@@ -0,0 +1,321 @@
+#include "outputcache.hpp"
+#include "json.hpp"
+#include "stringtable.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <vector>
+#include <linux/if.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace Preview {
+
+namespace {
+
+const size_t kMaxEntries = 64;
+
+// What an output depends on besides the passage of time.
+enum Depends {
+    kNothing = 0,
+    kNetwork = 1,  // interfaces, addresses, routes
+    kMounts = 2,   // the mount table
+    kPackages = 4, // the package database
+    kDevices = 8,  // USB/PCI/block devices and connected displays
+};
+
+struct Policy {
+    long ttl;
+    int depends;
+};
+
+const long kMinute = 60, kHour = 3600, kDay = 86400;
+const long kForever = -1; // text filters: they only pass on what earlier stages print
+
+// Programs not listed (date, uptime, free, ps, sensors, ls, cat...) report
+// something that changes by the second, or arbitrary files, and are not cached.
+const std::map<std::string, Policy> &policies() {
+    static const std::map<std::string, Policy> table = {
+        {"uname", {kDay, kNothing}}, {"lsb_release", {kDay, kNothing}}, {"hostnamectl", {kDay, kNothing}},
+        {"nproc", {kDay, kNothing}}, {"lscpu", {kDay, kNothing}}, {"dmidecode", {kDay, kNothing}},
+        {"whoami", {kDay, kNothing}}, {"id", {kDay, kNothing}}, {"groups", {kDay, kNothing}},
+        {"locale", {kDay, kNothing}}, {"localectl", {kDay, kNothing}}, {"which", {kDay, kPackages}},
+        {"whereis", {kDay, kPackages}}, {"gsettings", {kHour, kNothing}}, {"lsmod", {5 * kMinute, kDevices}},
+
+        {"lsusb", {kDay, kDevices}}, {"lspci", {kDay, kDevices}}, {"lshw", {kDay, kDevices}},
+        {"lsblk", {kHour, kDevices | kMounts}}, {"xrandr", {kHour, kDevices}}, {"wlr-randr", {kHour, kDevices}},
+        {"xdpyinfo", {kHour, kDevices}}, {"glxinfo", {kDay, kDevices | kPackages}}, {"vulkaninfo", {kDay, kDevices | kPackages}},
+        {"edid-decode", {kDay, kDevices}}, {"ddcutil", {5 * kMinute, kDevices}},
+
+        {"ip", {10 * kMinute, kNetwork}}, {"ifconfig", {10 * kMinute, kNetwork}}, {"iwconfig", {kMinute, kNetwork}},
+        {"iw", {kMinute, kNetwork}}, {"nmcli", {kMinute, kNetwork}}, {"resolvectl", {5 * kMinute, kNetwork}},
+        {"host", {5 * kMinute, kNetwork}}, {"dig", {5 * kMinute, kNetwork}}, {"nslookup", {5 * kMinute, kNetwork}},
+
+        {"df", {kMinute, kMounts}}, {"findmnt", {kHour, kMounts}},
+
+        {"pacman", {kHour, kPackages}}, {"pactree", {kHour, kPackages}}, {"expac", {kHour, kPackages}},
+        {"dpkg", {kHour, kPackages}}, {"dpkg-query", {kHour, kPackages}}, {"apt", {kHour, kPackages}},
+        {"apt-cache", {kHour, kPackages}}, {"apt-file", {kHour, kPackages}},
+
+        {"systemctl", {30, kNothing}}, {"loginctl", {30, kNothing}}, {"rfkill", {30, kNothing}},
+        {"bluetoothctl", {30, kNothing}}, {"pactl", {30, kNothing}}, {"wpctl", {30, kNothing}},
+
+        {"grep", {kForever, kNothing}}, {"egrep", {kForever, kNothing}}, {"fgrep", {kForever, kNothing}},
+        {"head", {kForever, kNothing}}, {"tail", {kForever, kNothing}}, {"wc", {kForever, kNothing}},
+        {"cut", {kForever, kNothing}}, {"sort", {kForever, kNothing}}, {"uniq", {kForever, kNothing}},
+        {"tr", {kForever, kNothing}}, {"column", {kForever, kNothing}},
+    };
+    return table;
+}
+
+// ip output the network fingerprint doesn't cover: counters (-s) and the
+// neighbour table change without any link, address or route changing.
+bool showsIpCounters(const std::string &command) {
+    static const std::set<std::string> volatileWords = {
+        "-s", "-stats", "-statistics", "n", "neigh", "neighbor", "neighbour", "ntable", "monitor"
+    };
+    std::istringstream words(command);
+    for (std::string word; words >> word;) {
+        if (volatileWords.count(word)) return true;
+    }
+    return false;
+}
+
+// TTL and dependencies of a whole command line; ttl 0 when not cacheable.
+Policy policyFor(const std::string &command) {
+    Policy combined = {0, kNothing};
+    if (!isReadOnly(command)) return combined;
+    std::vector<std::string> names = programs(command);
+    for (size_t i = 0; i < names.size(); ++i) {
+        auto policy = policies().find(names[i]);
+        if (policy == policies().end()) return {0, kNothing};
+        if (names[i] == "ip" && showsIpCounters(command)) return {0, kNothing};
+        // A filter at the start of a pipeline reads files, which can change anytime.
+        if (policy->second.ttl == kForever && i == 0) return {0, kNothing};
+        if (policy->second.ttl != kForever) {
+            combined.ttl = combined.ttl == 0 ? policy->second.ttl : std::min(combined.ttl, policy->second.ttl);
+        }
+        combined.depends |= policy->second.depends;
+    }
+    return combined;
+}
+
+uint64_t fnv(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t fnv(uint64_t hash, const std::string &text) { return fnv(hash, text.data(), text.size()); }
+
+std::string hex(uint64_t value) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+    return text;
+}
+
+// Hashes the attributes of one netlink message that identify configuration,
+// leaving out counters and lifetimes that tick on their own.
+uint64_t hashRouteMessage(uint64_t hash, const nlmsghdr *header) {
+    const rtattr *attribute = nullptr;
+    int length = 0;
+    std::vector<unsigned short> wanted;
+    if (header->nlmsg_type == RTM_NEWLINK) {
+        const ifinfomsg *info = static_cast<const ifinfomsg *>(NLMSG_DATA(header));
+        unsigned flags = info->ifi_flags & (IFF_UP | IFF_RUNNING | IFF_LOWER_UP);
+        hash = fnv(fnv(hash, &info->ifi_index, sizeof(info->ifi_index)), &flags, sizeof(flags));
+        attribute = IFLA_RTA(info);
+        length = IFLA_PAYLOAD(header);
+        wanted = {IFLA_IFNAME, IFLA_ADDRESS, IFLA_OPERSTATE, IFLA_MTU};
+    } else if (header->nlmsg_type == RTM_NEWADDR) {
+        const ifaddrmsg *info = static_cast<const ifaddrmsg *>(NLMSG_DATA(header));
+        hash = fnv(hash, info, sizeof(*info));
+        attribute = IFA_RTA(info);
+        length = IFA_PAYLOAD(header);
+        wanted = {IFA_ADDRESS, IFA_LOCAL};
+    } else if (header->nlmsg_type == RTM_NEWROUTE) {
+        const rtmsg *info = static_cast<const rtmsg *>(NLMSG_DATA(header));
+        if (info->rtm_table != RT_TABLE_MAIN) return hash;
+        hash = fnv(hash, info, sizeof(*info));
+        attribute = RTM_RTA(info);
+        length = RTM_PAYLOAD(header);
+        wanted = {RTA_DST, RTA_GATEWAY, RTA_OIF, RTA_PREFSRC};
+    }
+    for (; attribute && RTA_OK(attribute, length); attribute = RTA_NEXT(attribute, length)) {
+        if (std::find(wanted.begin(), wanted.end(), attribute->rta_type) == wanted.end()) continue;
+        hash = fnv(hash, &attribute->rta_type, sizeof(attribute->rta_type));
+        hash = fnv(hash, RTA_DATA(attribute), RTA_PAYLOAD(attribute));
+    }
+    return hash;
+}
+
+bool dumpInto(int fd, unsigned short type, uint64_t &hash) {
+    struct {
+        nlmsghdr header;
+        rtgenmsg message;
+    } request = {};
+    request.header.nlmsg_len = sizeof(request);
+    request.header.nlmsg_type = type;
+    request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    request.header.nlmsg_seq = type;
+    request.message.rtgen_family = AF_UNSPEC;
+    if (send(fd, &request, sizeof(request), 0) < 0) return false;
+
+    std::vector<char> buffer(32 * 1024);
+    for (;;) {
+        ssize_t received = recv(fd, buffer.data(), buffer.size(), 0);
+        if (received <= 0) return false;
+        int length = static_cast<int>(received);
+        for (const nlmsghdr *header = reinterpret_cast<const nlmsghdr *>(buffer.data()); NLMSG_OK(header, length);
+             header = NLMSG_NEXT(header, length)) {
+            if (header->nlmsg_type == NLMSG_DONE) return true;
+            if (header->nlmsg_type == NLMSG_ERROR) return false;
+            hash = hashRouteMessage(hash, header);
+        }
+    }
+}
+
+std::string mountsFingerprint() { return hex(fnv(1469598103934665603ULL, readFile("/proc/self/mountinfo"))); }
+
+std::string packagesFingerprint() {
+    return hex(fingerprintFiles({"/var/lib/pacman/local", "/var/lib/dpkg/status"}));
+}
+
+// Which devices are present, and which display connectors have something plugged in.
+std::string devicesFingerprint() {
+    uint64_t hash = 1469598103934665603ULL;
+    std::error_code error;
+    for (std::string dir : {"/sys/bus/usb/devices", "/sys/bus/pci/devices", "/sys/class/block", "/sys/class/drm"}) {
+        std::vector<std::string> names;
+        for (const auto &entry : std::filesystem::directory_iterator(dir, error)) {
+            names.push_back(entry.path().filename().string());
+            if (dir == "/sys/class/drm") names.back() += readFile(entry.path().string() + "/status");
+        }
+        std::sort(names.begin(), names.end());
+        for (const std::string &name : names) hash = fnv(hash, name + "\n");
+    }
+    return hex(hash);
+}
+
+std::string stateFingerprint(int depends) {
+    std::string state = readFile("/proc/sys/kernel/random/boot_id"); // a reboot invalidates everything
+    if (depends & kNetwork) state += "net:" + networkFingerprint() + ";";
+    if (depends & kMounts) state += "mnt:" + mountsFingerprint() + ";";
+    if (depends & kPackages) state += "pkg:" + packagesFingerprint() + ";";
+    if (depends & kDevices) state += "dev:" + devicesFingerprint() + ";";
+    return hex(fnv(1469598103934665603ULL, state));
+}
+
+// The command together with what in the environment can change its output.
+std::string entryKey(const std::string &command) {
+    std::string key = command;
+    for (const char *name : {"LANG", "LC_ALL", "LC_MESSAGES", "LANGUAGE", "TZ", "PATH"}) {
+        const char *value = std::getenv(name);
+        key += std::string("\n") + name + "=" + (value ? value : "");
+    }
+    std::error_code error;
+    key += "\ncwd=" + std::filesystem::current_path(error).string();
+    key += "\nuid=" + std::to_string(geteuid());
+    return hex(fnv(1469598103934665603ULL, key));
+}
+
+long now() { return static_cast<long>(std::time(nullptr)); }
+
+} // namespace
+
+std::string networkFingerprint() {
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) return "";
+    uint64_t hash = 1469598103934665603ULL;
+    bool ok = dumpInto(fd, RTM_GETLINK, hash) && dumpInto(fd, RTM_GETADDR, hash) && dumpInto(fd, RTM_GETROUTE, hash);
+    close(fd);
+    return ok ? hex(hash) : "";
+}
+
+long ttlSeconds(const std::string &command) { return policyFor(command).ttl; }
+
+OutputCache OutputCache::load(const std::string &path) {
+    OutputCache cache;
+    std::ifstream file(path);
+    if (!file.is_open()) return cache;
+    json j = json::parse(file, nullptr, false);
+    if (!j.is_object()) return cache;
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        if (!it->is_object()) continue;
+        Entry entry;
+        entry.command = it->value("command", "");
+        entry.output = it->value("output", "");
+        entry.stored_at = it->value("stored_at", 0L);
+        entry.state = it->value("state", "");
+        cache.entries[it.key()] = entry;
+    }
+    return cache;
+}
+
+void OutputCache::save(const std::string &path) const {
+    json j = json::object();
+    for (const auto &[key, entry] : entries) {
+        j[key] = {
+            {"command", entry.command},
+            {"output", entry.output},
+            {"stored_at", entry.stored_at},
+            {"state", entry.state}
+        };
+    }
+    // Write-then-rename so a concurrent run never reads a half-written file.
+    std::string tmpPath = path + ".tmp";
+    std::ofstream file(tmpPath);
+    if (!file.is_open()) return;
+    file << j.dump();
+    file.close();
+    std::rename(tmpPath.c_str(), path.c_str());
+}
+
+const OutputCache::Entry *OutputCache::find(const std::string &command) const {
+    auto it = entries.find(entryKey(command));
+    if (it == entries.end() || it->second.command != command) return nullptr;
+    Policy policy = policyFor(command);
+    long age = now() - it->second.stored_at;
+    if (policy.ttl <= 0 || age < 0 || age > policy.ttl) return nullptr;
+    if (it->second.state != stateFingerprint(policy.depends)) return nullptr;
+    return &it->second;
+}
+
+bool OutputCache::store(const std::string &command, const Result &result) {
+    if (!result.sandboxed || !result.complete || result.exit_code != 0) return false;
+    Policy policy = policyFor(command);
+    if (policy.ttl <= 0) return false;
+
+    Entry &entry = entries[entryKey(command)];
+    entry.command = command;
+    entry.output = result.output;
+    entry.stored_at = now();
+    entry.state = stateFingerprint(policy.depends);
+
+    // Expired entries go first, then the oldest, to keep the file small.
+    for (auto it = entries.begin(); it != entries.end();) {
+        Policy other = policyFor(it->second.command);
+        it = entry.stored_at - it->second.stored_at > other.ttl ? entries.erase(it) : std::next(it);
+    }
+    while (entries.size() > kMaxEntries) {
+        entries.erase(std::min_element(entries.begin(), entries.end(), [](const auto &a, const auto &b) {
+            return a.second.stored_at < b.second.stored_at;
+        }));
+    }
+    return true;
+}
+
+} // namespace Preview
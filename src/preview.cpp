@@ -0,0 +1,480 @@
+#include "preview.hpp"
+#include "process.hpp"
+#include "terminal.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <poll.h>
+#include <sys/mount.h>
+#include <sys/prctl.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace Preview {
+
+namespace {
+
+using Arguments = std::vector<std::string>;
+
+struct Rule {
+    // When non-empty, the first non-option argument must be one of these;
+    // "" allows giving none.
+    std::vector<std::string> subcommands = {};
+    // Arguments, or prefixes of them, that would make the program change state.
+    std::vector<std::string> forbidden = {};
+    // Extra test for programs whose modes are selected by options.
+    std::function<bool(const Arguments &)> check = {};
+    // Lists mounts, so the sandbox's own /dev would show up in its output.
+    bool mountTable = false;
+    // Output depends on capabilities (other processes' sockets, the kernel
+    // log, firmware tables) that root loses inside the sandbox.
+    bool privileged = false;
+};
+
+// Arguments that are not options.
+std::vector<std::string> operands(const Arguments &args) {
+    std::vector<std::string> words;
+    std::copy_if(args.begin(), args.end(), std::back_inserter(words), [](const std::string &arg) { return arg[0] != '-'; });
+    return words;
+}
+
+bool firstArgumentIn(const Arguments &args, std::initializer_list<const char *> allowed, const char *prefix = nullptr) {
+    if (args.empty()) return false;
+    if (prefix && args[0].compare(0, std::strlen(prefix), prefix) == 0) return true;
+    return std::find(allowed.begin(), allowed.end(), args[0]) != allowed.end();
+}
+
+const std::map<std::string, Rule> &rules() {
+    static const std::map<std::string, Rule> table = {
+        // Files, text and processes.
+        {"ls", {}}, {"cat", {}}, {"head", {}}, {"tail", {}}, {"wc", {}}, {"grep", {}}, {"egrep", {}}, {"fgrep", {}},
+        {"cut", {}}, {"uniq", {}}, {"tr", {}}, {"column", {}}, {"stat", {}}, {"file", {}}, {"du", {}}, {"tree", {}},
+        {"which", {}}, {"whereis", {}}, {"pwd", {}}, {"echo", {}}, {"printf", {}}, {"printenv", {}}, {"locale", {}},
+        {"ps", {}}, {"pgrep", {}}, {"pstree", {}}, {"lsof", {{}, {}, {}, false, true}}, {"sha256sum", {}}, {"md5sum", {}},
+        {"sort", {{}, {"-o", "--output"}}},
+        {"find", {{}, {"-delete", "-exec", "-execdir", "-ok", "-okdir", "-fprint", "-fprint0", "-fprintf", "-fls"}}},
+        {"date", {{}, {"-s", "--set"}, [](const Arguments &args) {
+            return std::all_of(args.begin(), args.end(), [](const std::string &arg) { return arg[0] == '-' || arg[0] == '+'; });
+        }}},
+
+        // System and hardware information.
+        {"df", {{}, {}, {}, true}}, {"findmnt", {{}, {}, {}, true}}, {"free", {}}, {"uptime", {}}, {"uname", {}}, {"whoami", {}}, {"id", {}}, {"groups", {}},
+        {"w", {}}, {"who", {}}, {"last", {}}, {"nproc", {}}, {"vmstat", {}}, {"iostat", {}}, {"mpstat", {}},
+        {"lsblk", {}}, {"lsusb", {}}, {"lspci", {}}, {"lscpu", {}}, {"lsmod", {}}, {"lshw", {{}, {}, {}, false, true}}, {"lsb_release", {}},
+        {"sensors", {}}, {"dmidecode", {{}, {}, {}, false, true}}, {"inxi", {}}, {"neofetch", {}}, {"fastfetch", {}},
+        {"screenfetch", {}}, {"xdpyinfo", {}}, {"glxinfo", {}}, {"vulkaninfo", {}}, {"edid-decode", {}},
+        {"dmesg", {{}, {"-C", "--clear", "-c", "--read-clear", "-D", "--console-off", "-E", "--console-on", "-n", "--console-level"}, {}, false, true}},
+        {"journalctl", {{}, {"--vacuum", "--rotate", "--flush", "--sync", "--relinquish-var", "--smart-relinquish-var", "--setup-keys", "--update-catalog"}}},
+        {"xrandr", {{""}, {"--auto", "--off", "--dpi", "--fb", "-s", "--size", "-o", "--orientation", "-x", "-y", "--primary", "--noprimary"}}},
+        {"wlr-randr", {{""}, {"--output", "--on", "--off", "--mode", "--pos", "--transform", "--scale", "--custom-mode", "--preferred"}}},
+        {"brightnessctl", {{"", "info", "get"}, {}}},
+        {"ddcutil", {{"detect", "capabilities", "getvcp", "environment", "interrogate"}, {}}},
+        {"upower", {{"", "-e", "--enumerate", "-i", "--show-info", "-d", "--dump", "-v", "--version"}, {}}},
+        {"hyprctl", {{"monitors", "workspaces", "clients", "devices", "activewindow", "activeworkspace", "version", "getoption", "layers"}, {}}},
+        {"gsettings", {{"get", "list-keys", "list-schemas", "list-recursively", "list-children", "range", "describe", "writable"}, {}}},
+
+        // Network state.
+        {"ip", {{"", "a", "addr", "address", "l", "link", "r", "route", "n", "neigh", "neighbor", "rule", "maddr", "netconf"},
+                {"add", "del", "delete", "set", "change", "replace", "flush", "append", "prepend", "save", "restore"}}},
+        {"ss", {{}, {}, {}, false, true}}, {"netstat", {{}, {}, {}, false, true}}, {"ifconfig", {{""}, {}}}, {"iwconfig", {{""}, {}}}, {"resolvectl", {{"", "status", "query", "statistics", "dns", "domain"}, {}, [](const Arguments &args) {
+            // "dns [link]" and "domain [link]" show; anything after the link sets.
+            std::vector<std::string> words = operands(args);
+            return words.empty() || (words[0] != "dns" && words[0] != "domain") || words.size() <= 2;
+        }}},
+        {"host", {}}, {"dig", {}}, {"nslookup", {}}, {"getent", {}},
+        {"nmcli", {{}, {"up", "down", "connect", "disconnect", "delete", "modify", "add", "reload", "on", "off", "edit", "reapply", "set", "import", "export",
+                    "hostname", "logging"}}},
+        {"iw", {{"dev", "list", "phy", "reg"}, {"set", "del", "add", "connect", "disconnect", "ibss", "mesh", "switch"}}},
+        {"rfkill", {{"", "list"}, {}}},
+        {"bluetoothctl", {{"show", "devices", "info", "list", "paired-devices", "version"}, {}}},
+
+        // Services, sessions, audio.
+        {"systemctl", {{"status", "list-units", "list-unit-files", "list-timers", "list-sockets", "list-dependencies",
+                        "is-active", "is-enabled", "is-failed", "show", "cat", "get-default"}, {}}},
+        {"timedatectl", {{"", "status", "show", "list-timezones", "timesync-status"}, {}}},
+        {"hostnamectl", {{"", "status"}, {}}},
+        {"localectl", {{"", "status", "list-locales", "list-keymaps", "list-x11-keymap-layouts"}, {}}},
+        {"loginctl", {{"list-sessions", "session-status", "show-session", "list-users", "user-status", "show-user", "list-seats"}, {}}},
+        {"pactl", {{"info", "list", "stat", "get-default-sink", "get-default-source", "get-sink-volume", "get-sink-mute",
+                    "get-source-volume", "get-source-mute"}, {}}},
+        {"wpctl", {{"status", "inspect", "get-volume"}, {}}},
+        {"amixer", {{"", "scontrols", "scontents", "controls", "contents", "sget", "cget", "info"}, {}}},
+
+        // Package queries.
+        {"pacman", {{}, {}, [](const Arguments &args) {
+            return firstArgumentIn(args, {"-Ss", "-Si", "-Sii", "-Sl", "-Sg", "-F", "-Fl", "-Fx", "--query"}, "-Q");
+        }}},
+        {"pactree", {}}, {"expac", {}}, {"dpkg-query", {}}, {"apt-file", {{"search", "find", "list", "show"}, {}}},
+        {"apt", {{"list", "show", "search", "policy", "depends", "rdepends"}, {}}},
+        {"apt-cache", {{"show", "search", "policy", "depends", "rdepends", "showpkg", "pkgnames", "stats", "madison", "showsrc"}, {}}},
+        {"dpkg", {{}, {}, [](const Arguments &args) {
+            return firstArgumentIn(args, {"-l", "-L", "-s", "-S", "-p", "--list", "--listfiles", "--status", "--search",
+                                          "--print-avail", "--get-selections", "--print-architecture"});
+        }}},
+    };
+    return table;
+}
+
+// Removes redirections that only discard or merge output.
+std::string withoutHarmlessRedirections(std::string command) {
+    for (const char *redirection : {"2>/dev/null", "&>/dev/null", ">/dev/null", "2>&1", "1>&2", ">&2"}) {
+        for (size_t at; (at = command.find(redirection)) != std::string::npos;) command.replace(at, std::strlen(redirection), " ");
+    }
+    return command;
+}
+
+// Splits a command line on ;, &&, || and |. Fails on a lone '&' (background job).
+bool splitStages(const std::string &text, std::vector<std::string> &stages) {
+    stages.assign(1, "");
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == ';' || c == '|' || c == '&') {
+            if (c == '&' && (i + 1 >= text.size() || text[i + 1] != '&')) return false;
+            if (i + 1 < text.size() && text[i + 1] == c) ++i;
+            stages.emplace_back();
+        } else {
+            stages.back() += c;
+        }
+    }
+    return true;
+}
+
+// Words of a stage after any leading VAR=value assignments.
+std::vector<std::string> stageWords(const std::string &stage) {
+    std::istringstream words(stage);
+    std::vector<std::string> tokens;
+    for (std::string word; words >> word;) {
+        if (tokens.empty() && word.find('=') != std::string::npos && word[0] != '-') continue; // LANG=C
+        tokens.push_back(word);
+    }
+    return tokens;
+}
+
+bool stageIsReadOnly(const std::string &stage) {
+    std::vector<std::string> tokens = stageWords(stage);
+    if (tokens.empty()) return false;
+    auto rule = rules().find(tokens[0].substr(tokens[0].rfind('/') + 1));
+    if (rule == rules().end()) return false;
+    Arguments args(tokens.begin() + 1, tokens.end());
+
+    for (const std::string &arg : args) {
+        bool shortOptions = arg.size() > 1 && arg[0] == '-' && arg[1] != '-';
+        for (const std::string &forbidden : rule->second.forbidden) {
+            // A short option may be bundled with others or carry its value
+            // ("sort -ro out", "sort -oout").
+            if (forbidden.size() == 2 && forbidden[0] == '-' && forbidden[1] != '-') {
+                if (shortOptions && arg.find(forbidden[1]) != std::string::npos) return false;
+                continue;
+            }
+            if (arg.compare(0, forbidden.size(), forbidden) == 0 &&
+                (arg.size() == forbidden.size() || arg[forbidden.size()] == '=' || forbidden.compare(0, 2, "--") == 0)) {
+                return false;
+            }
+        }
+    }
+    if (!rule->second.subcommands.empty()) {
+        auto subcommand = std::find_if(args.begin(), args.end(), [](const std::string &arg) { return arg[0] != '-'; });
+        std::string given = subcommand == args.end() ? "" : *subcommand;
+        const std::vector<std::string> &allowed = rule->second.subcommands;
+        if (std::find(allowed.begin(), allowed.end(), given) == allowed.end()) return false;
+    }
+    return !rule->second.check || rule->second.check(args);
+}
+
+// --- Sandbox (runs in the forked child) ---
+
+bool writeFile(const char *path, const std::string &text) {
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+    close(fd);
+    return ok;
+}
+
+// Covers /dev with a tmpfs holding just the harmless devices, so a root
+// command cannot reach disks or other hardware through device nodes (a
+// read-only mount does not stop writes to a device). The nodes are opened
+// before they are hidden and bound back in through /proc.
+bool minimalDev() {
+    const char *devices[] = {"null", "zero", "full", "random", "urandom", "tty"};
+    int handles[6];
+    for (int i = 0; i < 6; ++i) {
+        handles[i] = open((std::string("/dev/") + devices[i]).c_str(), O_PATH | O_CLOEXEC);
+    }
+    if (mount("tmpfs", "/dev", "tmpfs", MS_NOSUID | MS_NOEXEC, "mode=755,size=64k") != 0) return false;
+    for (int i = 0; i < 6; ++i) {
+        if (handles[i] < 0) continue; // e.g. no controlling terminal
+        std::string target = std::string("/dev/") + devices[i];
+        int fd = open(target.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0666);
+        if (fd < 0) return false;
+        close(fd);
+        std::string source = "/proc/self/fd/" + std::to_string(handles[i]);
+        if (mount(source.c_str(), target.c_str(), nullptr, MS_BIND, nullptr) != 0) return false;
+        close(handles[i]);
+    }
+    return symlink("/proc/self/fd", "/dev/fd") == 0 && symlink("/proc/self/fd/0", "/dev/stdin") == 0 &&
+           symlink("/proc/self/fd/1", "/dev/stdout") == 0 && symlink("/proc/self/fd/2", "/dev/stderr") == 0;
+}
+
+// Every mount read-only: one mount_setattr() where available, otherwise a
+// bind remount per mount point keeping the flags that are locked anyway.
+bool readOnlyMounts() {
+#ifdef __NR_mount_setattr
+    struct {
+        uint64_t attr_set, attr_clr, propagation, userns_fd;
+    } attr = {1 /* MOUNT_ATTR_RDONLY */, 0, 0, 0};
+    if (syscall(__NR_mount_setattr, AT_FDCWD, "/", 0x8000 /* AT_RECURSIVE */, &attr, sizeof(attr)) == 0) return true;
+#endif
+    std::ifstream mountinfo("/proc/self/mountinfo");
+    for (std::string line; std::getline(mountinfo, line);) {
+        std::istringstream fields(line);
+        std::string id, parent, device, root, mountPoint;
+        fields >> id >> parent >> device >> root >> mountPoint;
+        struct statvfs info;
+        if (statvfs(mountPoint.c_str(), &info) != 0) continue;
+        unsigned long flags = MS_REMOUNT | MS_BIND | MS_RDONLY;
+        if (info.f_flag & ST_NOSUID) flags |= MS_NOSUID;
+        if (info.f_flag & ST_NODEV) flags |= MS_NODEV;
+        if (info.f_flag & ST_NOEXEC) flags |= MS_NOEXEC;
+        if (info.f_flag & ST_NOATIME) flags |= MS_NOATIME;
+        if (info.f_flag & ST_NODIRATIME) flags |= MS_NODIRATIME;
+        if (info.f_flag & ST_RELATIME) flags |= MS_RELATIME;
+        if (mount(nullptr, mountPoint.c_str(), nullptr, flags, nullptr) != 0 && errno != EACCES && errno != ENOENT) return false;
+    }
+    return true;
+}
+
+bool installSeccomp() {
+#if defined(__x86_64__)
+    const uint32_t arch = AUDIT_ARCH_X86_64;
+#elif defined(__aarch64__)
+    const uint32_t arch = AUDIT_ARCH_AARCH64;
+#else
+    return true; // no filter for other architectures; namespaces and limits still apply
+#endif
+    std::vector<long> denied = {
+        SYS_ptrace, SYS_process_vm_readv, SYS_process_vm_writev, SYS_kill, SYS_tkill, SYS_tgkill,
+        SYS_mount, SYS_umount2, SYS_pivot_root, SYS_chroot, SYS_unshare, SYS_setns,
+        SYS_swapon, SYS_swapoff, SYS_reboot, SYS_init_module, SYS_finit_module, SYS_delete_module, SYS_kexec_load,
+        SYS_sethostname, SYS_setdomainname, SYS_settimeofday, SYS_clock_settime, SYS_clock_adjtime, SYS_adjtimex,
+        SYS_bpf, SYS_keyctl, SYS_add_key, SYS_request_key, SYS_acct, SYS_quotactl, SYS_perf_event_open,
+    };
+    std::vector<sock_filter> filter = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, arch)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, arch, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_KILL_PROCESS),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, nr)),
+        // No Unix sockets: they reach daemons (D-Bus, systemd, NetworkManager)
+        // outside the sandbox, which would make the change for us.
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SYS_socket, 0, 3),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, args[0])),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, AF_UNIX, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EACCES),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, offsetof(seccomp_data, nr)),
+    };
+    for (long nr : denied) {
+        filter.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(nr), 0, 1));
+        filter.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM));
+    }
+    filter.push_back(BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW));
+    sock_fprog program = {static_cast<unsigned short>(filter.size()), filter.data()};
+    return prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) == 0 &&
+           syscall(SYS_seccomp, SECCOMP_SET_MODE_FILTER, 0, &program) == 0;
+}
+
+[[noreturn]] void runChild(const std::string &command, const Limits &limits, int outputFd, int errorFd, uid_t uid, gid_t gid) {
+    auto fail = [errorFd](const char *step) {
+        int error = errno;
+        (void)!write(errorFd, step, std::strlen(step));
+        (void)!write(errorFd, ": ", 2);
+        (void)!write(errorFd, std::strerror(error), std::strlen(std::strerror(error)));
+        _exit(125);
+    };
+
+    setpgid(0, 0);
+    if (unshare(CLONE_NEWUSER | CLONE_NEWNS) != 0) fail("unshare");
+    if (!writeFile("/proc/self/setgroups", "deny") ||
+        !writeFile("/proc/self/uid_map", std::to_string(uid) + " " + std::to_string(uid) + " 1") ||
+        !writeFile("/proc/self/gid_map", std::to_string(gid) + " " + std::to_string(gid) + " 1")) fail("id map");
+    if (mount(nullptr, "/", nullptr, MS_REC | MS_PRIVATE, nullptr) != 0) fail("private mounts");
+
+    if (uid == 0 && !minimalDev()) fail("dev"); // others are kept out of devices by their permissions
+    if (!readOnlyMounts()) fail("read-only");
+
+    struct rlimit cpu = {static_cast<rlim_t>(limits.cpu_seconds), static_cast<rlim_t>(limits.cpu_seconds + 1)};
+    struct rlimit memory = {limits.memory_bytes, limits.memory_bytes};
+    struct rlimit none = {0, 0};
+    setrlimit(RLIMIT_CPU, &cpu);
+    setrlimit(RLIMIT_AS, &memory);
+    setrlimit(RLIMIT_FSIZE, &none);
+    setrlimit(RLIMIT_CORE, &none);
+    if (!installSeccomp()) fail("seccomp");
+
+    int null = open("/dev/null", O_RDONLY);
+    dup2(null, STDIN_FILENO);
+    dup2(outputFd, STDOUT_FILENO);
+    dup2(outputFd, STDERR_FILENO);
+    // Output goes to a terminal, so tools that page it must not wait for keys.
+    setenv("PAGER", "cat", 1);
+    setenv("SYSTEMD_PAGER", "cat", 1);
+    execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+    fail("exec");
+    _exit(125);
+}
+
+// A pty the size of our terminal, so the command lays out its output (columns,
+// colors) exactly as it would when run for real; output[0] is the master.
+bool openTerminal(int output[2]) {
+    output[0] = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (output[0] < 0) return false;
+    const char *name = nullptr;
+    if (grantpt(output[0]) != 0 || unlockpt(output[0]) != 0 || (name = ptsname(output[0])) == nullptr ||
+        (output[1] = open(name, O_RDWR | O_NOCTTY | O_CLOEXEC)) < 0) {
+        close(output[0]);
+        return false;
+    }
+    struct winsize size = {};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_row == 0) size.ws_row = 24;
+    size.ws_col = static_cast<unsigned short>(Terminal::width());
+    ioctl(output[1], TIOCSWINSZ, &size);
+    return true;
+}
+
+Result execute(const std::string &command, const Limits &limits, const std::atomic<bool> &cancelled) {
+    Result result;
+    int output[2], errors[2];
+    if (!openTerminal(output)) return result;
+    if (pipe2(errors, O_CLOEXEC) != 0) {
+        close(output[0]);
+        close(output[1]);
+        return result;
+    }
+    uid_t uid = getuid();
+    gid_t gid = getgid();
+    pid_t pid = fork();
+    if (pid == 0) runChild(command, limits, output[1], errors[1], uid, gid);
+    close(output[1]);
+    close(errors[1]);
+    if (pid < 0) {
+        close(output[0]);
+        close(errors[0]);
+        return result;
+    }
+    setpgid(pid, pid);
+    Process::trackGroup(pid, SIGKILL);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.timeout_ms);
+    bool killed = false;
+    char buffer[4096];
+    for (;;) {
+        if (cancelled || std::chrono::steady_clock::now() >= deadline || result.output.size() >= limits.max_output) {
+            kill(-pid, SIGKILL);
+            killed = true;
+            break;
+        }
+        pollfd ready = {output[0], POLLIN, 0};
+        if (poll(&ready, 1, 50) <= 0) continue;
+        ssize_t n = read(output[0], buffer, sizeof(buffer));
+        if (n > 0) {
+            result.output.append(buffer, std::min<size_t>(n, limits.max_output - result.output.size()));
+        } else if (n == 0 || errno != EINTR) {
+            break; // EIO: everything in the group closed the terminal
+        }
+    }
+    close(output[0]);
+
+    // The output can close before the shell exits; the deadline still holds.
+    int status = 0;
+    while (!killed && waitpid(pid, &status, WNOHANG) == 0) {
+        if (cancelled || std::chrono::steady_clock::now() >= deadline) {
+            kill(-pid, SIGKILL);
+            killed = true;
+        } else {
+            usleep(10 * 1000);
+        }
+    }
+    if (killed) {
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+        kill(-pid, SIGKILL); // leftovers that outlived the shell
+    }
+    Process::untrackGroup(pid);
+
+    std::string setupError;
+    for (ssize_t n; (n = read(errors[0], buffer, sizeof(buffer))) > 0;) setupError.append(buffer, n);
+    close(errors[0]);
+    if (!setupError.empty()) {
+        result.output = "sandbox unavailable (" + setupError + ")";
+        return result;
+    }
+    result.sandboxed = true;
+    result.complete = !killed && WIFEXITED(status);
+    result.exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    return result;
+}
+
+} // namespace
+
+bool isReadOnly(const std::string &command) {
+    std::string text = withoutHarmlessRedirections(command);
+    // Writes, substitutions and backgrounding are out; '<' from a file is fine.
+    if (text.find_first_of(">`\n") != std::string::npos || text.find("$(") != std::string::npos ||
+        text.find("<(") != std::string::npos) {
+        return false;
+    }
+    std::vector<std::string> stages;
+    if (!splitStages(text, stages)) return false;
+    return std::all_of(stages.begin(), stages.end(), stageIsReadOnly);
+}
+
+bool canPreview(const std::string &command) {
+    if (!isReadOnly(command)) return false;
+    if (geteuid() != 0) return true;
+    // Root previews get a replaced /dev, which would show up in mount
+    // listings, and no capabilities outside the sandbox.
+    for (const std::string &program : programs(command)) {
+        auto rule = rules().find(program);
+        if (rule != rules().end() && (rule->second.mountTable || rule->second.privileged)) return false;
+    }
+    return true;
+}
+
+std::vector<std::string> programs(const std::string &command) {
+    std::vector<std::string> stages, names;
+    splitStages(withoutHarmlessRedirections(command), stages);
+    for (const std::string &stage : stages) {
+        std::vector<std::string> words = stageWords(stage);
+        if (!words.empty()) names.push_back(words[0].substr(words[0].rfind('/') + 1));
+    }
+    return names;
+}
+
+Run::Run(const std::string &command, const Limits &limits) {
+    result = std::async(std::launch::async, [this, command, limits]() { return execute(command, limits, cancelled); }).share();
+}
+
+Run::~Run() {
+    cancel();
+    result.wait();
+}
+
+} // namespace Preview
@@ -0,0 +1,413 @@
+#include "process.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cctype>
+#include <cstdlib>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace Process {
+
+namespace {
+
+// Opens a pty pair; returns the master and sets slavePath.
+int openPty(std::string &slavePath) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (master < 0) return -1;
+    char *name = nullptr;
+    if (grantpt(master) != 0 || unlockpt(master) != 0 || (name = ptsname(master)) == nullptr) {
+        close(master);
+        return -1;
+    }
+    slavePath = name;
+
+    // Same width as our terminal so progress bars lay out the same way.
+    struct winsize size = {};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 || size.ws_col == 0) {
+        size.ws_row = 24;
+        size.ws_col = 100;
+    }
+    ioctl(master, TIOCSWINSZ, &size);
+    return master;
+}
+
+// Forks argv as the leader of a new session whose controlling terminal is the
+// pty slave; returns the child's pid or -1.
+pid_t spawnInPty(const std::vector<std::string> &argv, const std::string &slavePath) {
+    std::vector<char *> args;
+    for (const std::string &arg : argv) args.push_back(const_cast<char *>(arg.c_str()));
+    args.push_back(nullptr);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        setsid();
+        int slave = open(slavePath.c_str(), O_RDWR);
+        if (slave < 0) _exit(127);
+        ioctl(slave, TIOCSCTTY, 0);
+        dup2(slave, STDIN_FILENO);
+        dup2(slave, STDOUT_FILENO);
+        dup2(slave, STDERR_FILENO);
+        if (slave > STDERR_FILENO) close(slave);
+        execvp(args[0], args.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+volatile sig_atomic_t windowResized = 0;
+
+void onWindowResize(int) { windowResized = 1; }
+
+bool writeAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool isExecutable(const std::string &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode) && access(path.c_str(), X_OK) == 0;
+}
+
+// Full path of program, searched in PATH unless it contains a '/'; "" if not found.
+std::string findExecutable(const std::string &program) {
+    if (program.empty()) return "";
+    if (program.find('/') != std::string::npos) return isExecutable(program) ? program : "";
+    const char *path = std::getenv("PATH");
+    std::string dirs = path ? path : "/usr/local/bin:/usr/bin:/bin";
+    for (size_t start = 0; start <= dirs.size();) {
+        size_t end = dirs.find(':', start);
+        if (end == std::string::npos) end = dirs.size();
+        std::string candidate = dirs.substr(start, end - start) + "/" + program;
+        if (end > start && isExecutable(candidate)) return candidate;
+        start = end + 1;
+    }
+    return "";
+}
+
+// Tracked process groups; 0 is a free slot, -1 one being filled in.
+const int kMaxTracked = 32;
+std::atomic<pid_t> trackedGroups[kMaxTracked];
+std::atomic<int> trackedSignals[kMaxTracked];
+
+void onInterrupt(int signal) {
+    for (int i = 0; i < kMaxTracked; ++i) {
+        pid_t group = trackedGroups[i].load();
+        if (group > 0) kill(-group, trackedSignals[i].load());
+    }
+    ::signal(signal, SIG_DFL);
+    raise(signal);
+}
+
+int exitStatus(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return -1;
+}
+
+} // namespace
+
+int runInPty(const std::vector<std::string> &argv, const std::function<void(const std::string &)> &onOutput) {
+    if (argv.empty()) return -1;
+    std::string slavePath;
+    int master = openPty(slavePath);
+    if (master < 0) return -1;
+
+    pid_t pid = spawnInPty(argv, slavePath);
+    if (pid < 0) {
+        close(master);
+        return -1;
+    }
+
+    int status = 0;
+    bool reaped = false;
+    char buffer[4096];
+    while (!reaped) {
+        pollfd fd = {master, POLLIN, 0};
+        int ready = poll(&fd, 1, 100);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready > 0) {
+            ssize_t n = read(master, buffer, sizeof(buffer));
+            if (n > 0) {
+                if (onOutput) onOutput(std::string(buffer, n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            break; // EIO once the child and its descendants closed the pty
+        }
+        // The child may exit while something it started in the background
+        // still holds the pty open; don't wait for that.
+        if (ready == 0) reaped = waitpid(pid, &status, WNOHANG) == pid;
+    }
+    // Pass on what the child wrote before exiting, but nothing the
+    // background is still writing.
+    int pending = 0;
+    if (reaped && ioctl(master, FIONREAD, &pending) != 0) pending = 0;
+    while (pending > 0) {
+        ssize_t n = read(master, buffer, std::min(sizeof(buffer), static_cast<size_t>(pending)));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        if (onOutput) onOutput(std::string(buffer, n));
+        pending -= static_cast<int>(n);
+    }
+    close(master);
+
+    while (!reaped && waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return exitStatus(status);
+}
+
+int run(const std::vector<std::string> &argv, std::string *output) {
+    if (argv.empty()) return -1;
+    std::vector<char *> args;
+    for (const std::string &arg : argv) args.push_back(const_cast<char *>(arg.c_str()));
+    args.push_back(nullptr);
+
+    int pipeFds[2] = {-1, -1};
+    if (output && pipe2(pipeFds, O_CLOEXEC) != 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_RDWR);
+        dup2(null, STDIN_FILENO);
+        dup2(output ? pipeFds[1] : null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execvp(args[0], args.data());
+        _exit(127);
+    }
+    if (output) {
+        close(pipeFds[1]);
+        char buffer[4096];
+        while (pid > 0) {
+            ssize_t n = read(pipeFds[0], buffer, sizeof(buffer));
+            if (n > 0) {
+                output->append(buffer, n);
+            } else if (n == 0 || errno != EINTR) {
+                break;
+            }
+        }
+        close(pipeFds[0]);
+    }
+    if (pid < 0) return -1;
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return -1;
+    }
+    return exitStatus(status);
+}
+
+Usage runAttached(const std::vector<std::string> &argv, const std::function<void(const std::string &)> &onOutput) {
+    Usage usage;
+    if (argv.empty()) return usage;
+    std::string slavePath;
+    int master = openPty(slavePath);
+    if (master < 0) return usage;
+
+    // Our terminal goes to raw mode so every key (Ctrl-C included) reaches the
+    // child through its pty instead of acting on sysiq.
+    bool terminal = isatty(STDIN_FILENO);
+    struct termios saved = {};
+    if (terminal && tcgetattr(STDIN_FILENO, &saved) == 0) {
+        struct termios raw = saved;
+        cfmakeraw(&raw);
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    } else {
+        terminal = false;
+    }
+    struct sigaction resize = {}, previousResize = {};
+    resize.sa_handler = onWindowResize;
+    sigaction(SIGWINCH, &resize, &previousResize);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = spawnInPty(argv, slavePath);
+    struct rusage resources = {};
+    int status = 0;
+    bool reaped = pid < 0;
+    bool inputOpen = true;
+    char buffer[4096];
+    while (!reaped) {
+        if (windowResized) {
+            windowResized = 0;
+            struct winsize size = {};
+            if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0) ioctl(master, TIOCSWINSZ, &size);
+        }
+        pollfd fds[2] = {{master, POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+        int ready = poll(fds, inputOpen ? 2 : 1, 100);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready > 0 && (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t n = read(master, buffer, sizeof(buffer));
+            if (n > 0) {
+                writeAll(STDOUT_FILENO, buffer, static_cast<size_t>(n));
+                if (onOutput) onOutput(std::string(buffer, n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            // EIO: everything holding the pty has closed it; reap below.
+            reaped = wait4(pid, &status, 0, &resources) == pid;
+            break;
+        }
+        if (ready > 0 && inputOpen && (fds[1].revents & (POLLIN | POLLHUP))) {
+            ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (n > 0) {
+                writeAll(master, buffer, static_cast<size_t>(n));
+            } else if (n == 0 || errno != EINTR) {
+                // Input ended (piped stdin): pass EOF on as the pty's EOF character.
+                struct termios modes = {};
+                char eof = tcgetattr(master, &modes) == 0 ? static_cast<char>(modes.c_cc[VEOF]) : '\x04';
+                writeAll(master, &eof, 1);
+                inputOpen = false;
+            }
+        }
+        // The shell may exit while something it started in the background
+        // still holds the pty open; don't wait for that.
+        if (ready == 0) reaped = wait4(pid, &status, WNOHANG, &resources) == pid;
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (!reaped && pid > 0) {
+        while (wait4(pid, &status, 0, &resources) < 0 && errno == EINTR) {}
+        reaped = true;
+    }
+    close(master);
+    sigaction(SIGWINCH, &previousResize, nullptr);
+    if (terminal) tcsetattr(STDIN_FILENO, TCSADRAIN, &saved);
+
+    if (pid < 0) return usage;
+    usage.exit_code = exitStatus(status);
+    usage.wall_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    usage.user_ms = resources.ru_utime.tv_sec * 1000.0 + resources.ru_utime.tv_usec / 1000.0;
+    usage.system_ms = resources.ru_stime.tv_sec * 1000.0 + resources.ru_stime.tv_usec / 1000.0;
+    usage.peak_rss_kib = resources.ru_maxrss;
+    return usage;
+}
+
+std::vector<std::string> shellCommand(const std::string &configuredShell, const std::string &command) {
+    // The setup prompt takes free text ("zsh", "/usr/bin/fish", "Bash 5.2"):
+    // use its first word, lower-cased.
+    std::string program = configuredShell.substr(0, configuredShell.find_first_of(" \t"));
+    for (char &c : program) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    std::string shell = findExecutable(program);
+    if (shell.empty()) {
+        const char *login = std::getenv("SHELL");
+        shell = login ? findExecutable(login) : "";
+    }
+    if (shell.empty()) shell = "/bin/sh";
+    return {shell, "-c", command};
+}
+
+void execInPlace(const std::vector<std::string> &argv) {
+    if (argv.empty()) return;
+    std::vector<char *> args;
+    for (const std::string &arg : argv) args.push_back(const_cast<char *>(arg.c_str()));
+    args.push_back(nullptr);
+    execvp(args[0], args.data());
+}
+
+void trackGroup(pid_t group, int signal) {
+    for (int i = 0; i < kMaxTracked; ++i) {
+        pid_t free = 0;
+        if (!trackedGroups[i].compare_exchange_strong(free, -1)) continue;
+        trackedSignals[i].store(signal);
+        trackedGroups[i].store(group);
+        return;
+    }
+}
+
+void untrackGroup(pid_t group) {
+    for (int i = 0; i < kMaxTracked; ++i) {
+        pid_t tracked = group;
+        if (trackedGroups[i].compare_exchange_strong(tracked, 0)) return;
+    }
+}
+
+void killTrackedOnSignal() {
+    struct sigaction interrupt = {};
+    interrupt.sa_handler = onInterrupt;
+    for (int signal : {SIGINT, SIGTERM, SIGHUP}) sigaction(signal, &interrupt, nullptr);
+}
+
+void LineSplitter::feed(const std::string &chunk) {
+    for (char c : chunk) {
+        if (c == '\n' || c == '\r') {
+            if (!pending.empty()) onLine(pending);
+            pending.clear();
+        } else {
+            pending += c;
+        }
+    }
+}
+
+void LineSplitter::finish() {
+    if (!pending.empty()) onLine(pending);
+    pending.clear();
+}
+
+Background::Background(const std::vector<std::string> &argv) {
+    if (argv.empty()) return;
+    std::vector<char *> args;
+    for (const std::string &arg : argv) args.push_back(const_cast<char *>(arg.c_str()));
+    args.push_back(nullptr);
+
+    pid = fork();
+    if (pid == 0) {
+        setpgid(0, 0);
+        setpriority(PRIO_PROCESS, 0, 10);
+        syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, 0, 3 << 13 /* IOPRIO_CLASS_IDLE */);
+        int null = open("/dev/null", O_RDWR);
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        if (null > STDERR_FILENO) close(null);
+        execvp(args[0], args.data());
+        _exit(127);
+    }
+    if (pid > 0) {
+        setpgid(pid, pid); // also from the parent, so cancel() can't race the child
+        trackGroup(pid, SIGTERM);
+    }
+}
+
+bool Background::running() {
+    if (pid <= 0) return false;
+    int raw = 0;
+    if (waitpid(pid, &raw, WNOHANG) == pid) {
+        untrackGroup(pid);
+        status = exitStatus(raw);
+        pid = -1;
+        return false;
+    }
+    return true;
+}
+
+void Background::cancel() {
+    if (!running()) return;
+    kill(-pid, SIGTERM);
+    wait();
+}
+
+int Background::wait() {
+    if (pid > 0) {
+        int raw = 0;
+        while (waitpid(pid, &raw, 0) < 0 && errno == EINTR) {}
+        untrackGroup(pid);
+        status = exitStatus(raw);
+        pid = -1;
+    }
+    return status;
+}
+
+} // namespace Process
@@ -0,0 +1,302 @@
+#include "provider.hpp"
+#include "http.hpp"
+#include "json.hpp"
+#include "log.hpp"
+#include "stats.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+
+using json = nlohmann::json;
+
+namespace AI {
+
+namespace {
+
+std::string withTrailingSlash(std::string url) {
+    if (!url.empty() && url.back() != '/') url += '/';
+    return url;
+}
+
+std::string apiKeyFor(const ProviderSettings &settings, const std::string &fallback) {
+    if (!settings.api_key_env.empty()) {
+        const char *key = std::getenv(settings.api_key_env.c_str());
+        return key ? key : "";
+    }
+    return fallback;
+}
+
+Completion post(const std::string &url, const std::vector<std::string> &headers, const json &payload) {
+    std::string payloadStr = payload.dump();
+    LOG_DEBUG("http request", {"url", url}, {"bytes", payloadStr.size()});
+    LOG_TRACE("http request body", {"headers", headers}, {"body", payloadStr});
+
+    Http::Request request;
+    request.url = url;
+    request.headers = headers;
+    request.body = payloadStr;
+    auto start = std::chrono::steady_clock::now();
+    Http::Response response = Http::transport().perform(request);
+    long ms = static_cast<long>(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+    Completion completion;
+    if (!response.error.empty()) {
+        LOG_WARN("http failed", {"url", url}, {"error", response.error}, {"ms", ms});
+        completion.error = response.error;
+    } else if (response.status != 200) {
+        LOG_WARN("http status", {"url", url}, {"status", response.status}, {"ms", ms});
+        LOG_TRACE("http response body", {"body", response.body});
+        completion.error = "HTTP " + std::to_string(response.status);
+    } else {
+        LOG_DEBUG("http response", {"status", response.status}, {"bytes", response.body.size()}, {"ms", ms});
+        LOG_TRACE("http response body", {"body", response.body});
+        completion.text = response.body;
+    }
+    return completion;
+}
+
+// Replaces the raw response body with the reply text found at path.
+template <typename F>
+Completion extract(Completion completion, F path) {
+    if (completion.text.empty()) return completion;
+    try {
+        completion.text = path(json::parse(completion.text));
+    } catch (json::exception &e) {
+        LOG_WARN("reply is not json", {"error", e.what()});
+        completion.error = e.what();
+        completion.text.clear();
+    }
+    return completion;
+}
+
+// Google Gemini generateContent.
+class GeminiProvider : public Provider {
+public:
+    GeminiProvider(std::string base, std::string key) : base(withTrailingSlash(std::move(base))), key(std::move(key)) {
+        Log::addSecret(this->key);
+    }
+
+    Completion complete(const CompletionRequest &request) override {
+        std::string url = base + "v1beta/models/" + request.model + ":generateContent?key=" + key;
+        Completion completion = post(url, {"Content-Type: application/json"}, geminiPayload(request));
+        return extract(completion, geminiReplyText);
+    }
+
+    std::string baseUrl() const override { return base; }
+
+    std::string cachePrefix(const CompletionRequest &prefix, int ttlSeconds) override {
+        json payload = geminiPayload(prefix);
+        payload.erase("generationConfig");
+        payload["model"] = "models/" + prefix.model;
+        payload["ttl"] = std::to_string(ttlSeconds) + "s";
+
+        Http::Request request;
+        request.url = base + "v1beta/cachedContents?key=" + key;
+        request.headers = {"Content-Type: application/json"};
+        request.body = payload.dump();
+        Http::Response response = Http::transport().perform(request);
+        json created = json::parse(response.body, nullptr, false);
+        if (response.status != 200 || !created.is_object() || !created.contains("name")) {
+            // Typically the prefix is below the model's minimum cacheable size.
+            LOG_INFO("context cache not created", {"error", response.error.empty() ? "HTTP " + std::to_string(response.status) : response.error});
+            return "";
+        }
+        return created["name"].get<std::string>();
+    }
+
+    void dropCache(const std::string &name) override {
+        Http::Request request;
+        request.method = "DELETE";
+        request.url = base + "v1beta/" + name + "?key=" + key;
+        request.timeout_seconds = 10;
+        Http::Response response = Http::transport().perform(request);
+        if (response.status != 200) {
+            LOG_INFO("context cache not deleted", {"name", name}, {"error", response.error.empty() ? "HTTP " + std::to_string(response.status) : response.error});
+        }
+    }
+
+private:
+    std::string base;
+    std::string key;
+};
+
+// Any OpenAI-compatible /chat/completions endpoint (llama.cpp server, vLLM,
+// Ollama, LM Studio, ...), local or remote.
+class OpenAIProvider : public Provider {
+public:
+    OpenAIProvider(std::string base, std::string key) : base(withTrailingSlash(std::move(base))), key(std::move(key)) {
+        Log::addSecret(this->key);
+    }
+
+    Completion complete(const CompletionRequest &request) override {
+        json messages = json::array();
+        if (!request.system.empty()) {
+            messages.push_back({{"role", "system"}, {"content", request.system}});
+        }
+        for (const Message &message : request.messages) {
+            messages.push_back({{"role", message.role == "model" ? "assistant" : "user"}, {"content", message.text}});
+        }
+        json payload = {
+            {"model", request.model},
+            {"messages", messages},
+            {"temperature", 0.2}
+        };
+        customize(payload, request);
+
+        std::vector<std::string> headers = {"Content-Type: application/json"};
+        if (!key.empty()) headers.push_back("Authorization: Bearer " + key);
+        Completion completion = post(base + "chat/completions", headers, payload);
+        return extract(completion, [this](const json &raw) {
+            report(raw);
+            return raw.at("choices").at(0).at("message").at("content").get<std::string>();
+        });
+    }
+
+    std::string baseUrl() const override { return base; }
+
+protected:
+    // Hooks for servers that accept extensions to the OpenAI payload.
+    virtual void customize(json &, const CompletionRequest &) const {}
+    virtual void report(const json &) const {}
+
+private:
+    std::string base;
+    std::string key;
+};
+
+// Grammars restricting local decoding to exactly the package-list shapes, so a
+// small quantized model cannot wander off into prose or broken JSON.
+const char *kPackageListGrammar = R"GBNF(
+root    ::= list ws
+list    ::= "[" ws item (ws "," ws item)* ws "]"
+item    ::= "{" ws "\"package_name\"" ws ":" ws name ws "," ws "\"command\"" ws ":" ws string ws "}"
+name    ::= "\"" [a-zA-Z0-9@._+-]+ "\""
+string  ::= "\"" ( [^"\\\x00-\x1f] | "\\" ["\\/bfnrt] )* "\""
+ws      ::= [ \t\n]*
+)GBNF";
+
+const char *kKeyedPackageListGrammar = R"GBNF(
+root    ::= "{" ws entry (ws "," ws entry)* ws "}" ws
+entry   ::= "\"" [a-zA-Z0-9_]+ "\"" ws ":" ws list
+list    ::= "[" ws item (ws "," ws item)* ws "]"
+item    ::= "{" ws "\"package_name\"" ws ":" ws name ws "," ws "\"command\"" ws ":" ws string ws "}"
+name    ::= "\"" [a-zA-Z0-9@._+-]+ "\""
+string  ::= "\"" ( [^"\\\x00-\x1f] | "\\" ["\\/bfnrt] )* "\""
+ws      ::= [ \t\n]*
+)GBNF";
+
+// llama.cpp server running a GGUF model on this host's CPU. The server mmaps
+// the weights and uses its SIMD kernels; we add grammar-constrained decoding
+// and prompt caching, which reuses the KV cache for the static instruction
+// prefix across queries.
+class LlamaProvider : public OpenAIProvider {
+public:
+    using OpenAIProvider::OpenAIProvider;
+
+protected:
+    void customize(json &payload, const CompletionRequest &request) const override {
+        payload["grammar"] = request.keyed ? kKeyedPackageListGrammar : kPackageListGrammar;
+        payload["cache_prompt"] = true;
+        payload["max_tokens"] = request.keyed ? 4096 : 512;
+    }
+
+    void report(const json &raw) const override {
+        auto timings = raw.find("timings");
+        if (timings == raw.end() || !timings->is_object()) return;
+        double promptMs = timings->value("prompt_ms", 0.0);
+        double predictedMs = timings->value("predicted_ms", 0.0);
+        long promptTokens = timings->value("prompt_n", 0L);
+        long cachedTokens = timings->value("cache_n", 0L);
+        long predictedTokens = timings->value("predicted_n", 0L);
+        double tokensPerSecond = timings->value("predicted_per_second",
+                                                predictedMs > 0 ? predictedTokens * 1000.0 / predictedMs : 0.0);
+        // Time to first token is the prefill of the uncached part of the prompt
+        // plus one decoding step.
+        double firstTokenMs = promptMs + (predictedTokens > 0 ? predictedMs / predictedTokens : 0.0);
+        LOG_INFO("local inference", {"first_token_ms", static_cast<long>(firstTokenMs)}, {"prompt_tokens", promptTokens},
+                 {"cached_tokens", cachedTokens}, {"generated_tokens", predictedTokens},
+                 {"tokens_per_second", static_cast<long>(tokensPerSecond)});
+    }
+};
+
+} // namespace
+
+json geminiPayload(const CompletionRequest &request) {
+    // With a usable server-side cache, only the uncached tail is sent.
+    bool useCache = !request.cached_content.empty() && request.cached_model == request.model &&
+                    request.cached_messages < request.messages.size();
+    json contents = json::array();
+    for (size_t i = useCache ? request.cached_messages : 0; i < request.messages.size(); ++i) {
+        const Message &message = request.messages[i];
+        contents.push_back({{"role", message.role}, {"parts", {{{"text", message.text}}}}});
+    }
+    json payload = {
+        {"contents", contents},
+        {"generationConfig", {
+             {"response_mime_type", "application/json"}
+        }}
+    };
+    if (useCache) {
+        payload["cachedContent"] = request.cached_content;
+    } else if (!request.system.empty()) {
+        payload["systemInstruction"] = {{"parts", {{{"text", request.system}}}}};
+    }
+    return payload;
+}
+
+std::string geminiReplyText(const json &response) {
+    return response.at("candidates").at(0).at("content").at("parts").at(0).at("text").get<std::string>();
+}
+
+std::unique_ptr<Provider> makeProvider(const ProviderSettings &settings, const std::string &geminiApiKey) {
+    if (settings.type == "llama") {
+        return std::make_unique<LlamaProvider>(settings.base_url, apiKeyFor(settings, ""));
+    }
+    if (settings.type == "openai") {
+        return std::make_unique<OpenAIProvider>(settings.base_url, apiKeyFor(settings, ""));
+    }
+    if (settings.type == "gemini") {
+        return std::make_unique<GeminiProvider>(settings.base_url, apiKeyFor(settings, geminiApiKey));
+    }
+    LOG_ERROR("unknown provider type", {"type", settings.type});
+    return nullptr;
+}
+
+Route resolveRoute(const Config &config, const std::string &entry) {
+    // "provider:model" only when the prefix names a configured provider, since
+    // model names themselves may contain ':' (e.g. "llama3:8b").
+    size_t colon = entry.find(':');
+    if (colon != std::string::npos && config.providers.count(entry.substr(0, colon))) {
+        return {entry, entry.substr(0, colon), entry.substr(colon + 1)};
+    }
+    return {entry, config.provider, entry};
+}
+
+Route chooseRoute(const Config &config, const std::string &tier, const LatencyStats &stats) {
+    Route best;
+    double bestMedian = 0;
+    bool haveBest = false;
+    std::stringstream alternatives(tier);
+    std::string entry;
+    while (std::getline(alternatives, entry, '|')) {
+        if (entry.empty()) continue;
+        double median = stats.median(entry);
+        if (!haveBest || median < bestMedian) {
+            best = resolveRoute(config, entry);
+            bestMedian = median;
+            haveBest = true;
+        }
+    }
+    return best;
+}
+
+std::unique_ptr<Provider> makeProvider(const Config &config, const Route &route, const std::string &geminiApiKey) {
+    auto settings = config.providers.find(route.providerName);
+    if (settings == config.providers.end()) {
+        LOG_ERROR("unknown provider", {"provider", route.providerName}, {"tier", route.key});
+        return nullptr;
+    }
+    return makeProvider(settings->second, geminiApiKey);
+}
+
+} // namespace AI
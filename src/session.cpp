@@ -0,0 +1,149 @@
+#include "session.hpp"
+#include "log.hpp"
+#include "utils.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace AI {
+
+namespace {
+
+// Gemini rejects caches below a model-dependent minimum size; don't bother
+// trying until the stable prefix is at least this large.
+const double kMinCacheTokens = 1024.0;
+const int kCacheTtlSeconds = 3600;
+const int kCacheRetrySeconds = 600;
+const double kCacheRetryGrowth = 1.5; // a rejected prefix is retried once this much larger
+
+double estimateTokens(const std::string &text) {
+    return text.size() / 4.0;
+}
+
+double historyTokens(const std::vector<Message> &turns) {
+    double tokens = 0;
+    for (const Message &turn : turns) tokens += estimateTokens(turn.text) + 4;
+    return tokens;
+}
+
+long long now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+Session Session::load(const std::string &name) {
+    Session session;
+    session.path = cachePath("session-" + name + ".json");
+    std::ifstream file(session.path);
+    json j = json::parse(file, nullptr, false);
+    if (!j.is_object()) return session;
+
+    for (const json &turn : j.value("turns", json::array())) {
+        session.turns.push_back({turn.value("role", "user"), turn.value("text", "")});
+    }
+    json cache = j.value("cache", json::object());
+    session.cache_name = cache.value("name", "");
+    session.cache_model = cache.value("model", "");
+    session.cached_turns = cache.value("turns", 0UL);
+    session.cache_expires = cache.value("expires", 0LL);
+    session.cache_retry_after = cache.value("retry_after", 0LL);
+    session.cache_retry_tokens = cache.value("retry_tokens", 0.0);
+    return session;
+}
+
+void Session::save() const {
+    json j;
+    j["turns"] = json::array();
+    for (const Message &turn : turns) {
+        j["turns"].push_back({{"role", turn.role}, {"text", turn.text}});
+    }
+    j["cache"] = {{"name", cache_name}, {"model", cache_model}, {"turns", cached_turns}, {"expires", cache_expires},
+                  {"retry_after", cache_retry_after}, {"retry_tokens", cache_retry_tokens}};
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath);
+        file << j.dump();
+    }
+    std::rename(tmpPath.c_str(), path.c_str());
+}
+
+PackageListResponse querySession(const Config &config, Session &session, const std::string &userQuery,
+                                 const std::string &apiKey, const PackageValidator &validator) {
+    // Drop the oldest exchanges once the history exceeds the budget, down to
+    // half of it: the cache no longer matches the history after a trim, and
+    // the headroom lets the next one serve several turns before it is
+    // rebuilt.
+    std::string staleCache;
+    if (historyTokens(session.turns) > config.session_token_budget) {
+        while (session.turns.size() >= 2 && historyTokens(session.turns) > config.session_token_budget / 2.0) {
+            session.turns.erase(session.turns.begin(), session.turns.begin() + 2);
+        }
+        staleCache = session.cache_name;
+        session.cache_name.clear();
+        session.cached_turns = 0;
+    }
+
+    // The system description goes with the instructions rather than in the
+    // first turn, so trimming the history never loses it (and it is part of
+    // the cached prefix).
+    CompletionRequest request = packageListRequest(config, userQuery);
+    request.system += "\n" + describeSystem(config);
+    Message turn{"user", "Query: " + userQuery};
+    request.messages = session.turns;
+    request.messages.push_back(turn);
+
+    // Reuse or create a server-side cache for the stable prefix (instructions
+    // plus the history so far) on the first tier's provider.
+    if (!config.models.empty()) {
+        Route route = chooseRoute(config, config.models.front(), LatencyStats::load(cachePath("tiers.json")));
+        bool valid = !session.cache_name.empty() && session.cache_model == route.model &&
+                     session.cache_expires > now() + 60 && session.cached_turns <= session.turns.size();
+        if (!valid && !session.cache_name.empty() && session.cache_expires > now()) staleCache = session.cache_name;
+        double prefixTokens = estimateTokens(request.system) + historyTokens(session.turns);
+        bool retry = now() >= session.cache_retry_after || prefixTokens >= session.cache_retry_tokens;
+        std::unique_ptr<Provider> provider = makeProvider(config, route, apiKey);
+        // Caches are billed until they expire, so one being replaced goes now.
+        if (provider && !staleCache.empty()) {
+            provider->dropCache(staleCache);
+            session.cache_name.clear();
+            session.cached_turns = 0;
+        }
+        if (provider && !valid && retry && !session.turns.empty() && prefixTokens >= kMinCacheTokens) {
+            CompletionRequest prefix = request;
+            prefix.model = route.model;
+            prefix.messages = session.turns;
+            std::string name = provider->cachePrefix(prefix, kCacheTtlSeconds);
+            if (name.empty()) {
+                session.cache_retry_after = now() + kCacheRetrySeconds;
+                session.cache_retry_tokens = prefixTokens * kCacheRetryGrowth;
+            } else {
+                session.cache_name = name;
+                session.cache_model = route.model;
+                session.cached_turns = session.turns.size();
+                session.cache_expires = now() + kCacheTtlSeconds;
+                valid = true;
+            }
+        }
+        if (valid) {
+            request.cached_content = session.cache_name;
+            request.cached_model = session.cache_model;
+            request.cached_messages = session.cached_turns;
+        }
+    }
+
+    LOG_INFO("session", {"file", session.path}, {"earlier_turns", session.turns.size()},
+             {"history_tokens", static_cast<long>(historyTokens(session.turns))}, {"cached_turns", request.cached_messages});
+
+    PackageListResponse response = queryPackageList(config, request, apiKey, validator);
+    if (!response.packages.empty()) {
+        // Store the answer compactly rather than the raw model text.
+        session.turns.push_back(turn);
+        session.turns.push_back({"model", toJson(response)["packages"].dump()});
+    }
+    session.save();
+    return response;
+}
+
+} // namespace AI
@@ -0,0 +1,89 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const size_t kMaxSamples = 100;
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return -1;
+    std::sort(values.begin(), values.end());
+    return values[static_cast<size_t>(p * (values.size() - 1) + 0.5)];
+}
+
+// A count from a file that may have been edited or corrupted; 0 if absent or
+// not a number.
+long count(const json &entry, const char *key) {
+    auto field = entry.find(key);
+    return field != entry.end() && field->is_number() ? field->get<long>() : 0;
+}
+
+} // namespace
+
+LatencyStats LatencyStats::load(const std::string &path) {
+    LatencyStats stats;
+    std::ifstream file(path);
+    if (!file.is_open()) return stats;
+    json j = json::parse(file, nullptr, false);
+    if (!j.is_object()) return stats;
+    for (auto it = j.begin(); it != j.end(); ++it) {
+        if (!it->is_object()) continue;
+        Entry entry;
+        entry.calls = count(*it, "calls");
+        entry.rejected = count(*it, "rejected");
+        auto samples = it->find("samples_ms");
+        if (samples != it->end() && samples->is_array()) {
+            for (const json &sample : *samples) {
+                if (sample.is_number()) entry.samples_ms.push_back(sample.get<double>());
+            }
+        }
+        stats.entries[it.key()] = entry;
+    }
+    return stats;
+}
+
+void LatencyStats::save(const std::string &path) const {
+    json j = json::object();
+    for (const auto &[key, entry] : entries) {
+        j[key] = {
+            {"calls", entry.calls},
+            {"rejected", entry.rejected},
+            {"samples_ms", entry.samples_ms}
+        };
+    }
+    // Write-then-rename so a concurrent run never reads a half-written file.
+    std::string tmpPath = path + ".tmp";
+    std::ofstream file(tmpPath);
+    if (!file.is_open()) return;
+    file << j.dump();
+    file.close();
+    std::rename(tmpPath.c_str(), path.c_str());
+}
+
+void LatencyStats::record(const std::string &key, double ms, bool accepted) {
+    Entry &entry = entries[key];
+    entry.calls++;
+    if (!accepted) entry.rejected++;
+    entry.samples_ms.push_back(ms);
+    if (entry.samples_ms.size() > kMaxSamples) entry.samples_ms.pop_front();
+}
+
+double LatencyStats::median(const std::string &key) const {
+    auto it = entries.find(key);
+    if (it == entries.end()) return -1;
+    return percentile({it->second.samples_ms.begin(), it->second.samples_ms.end()}, 0.5);
+}
+
+void LatencyStats::print() const {
+    std::printf("%-32s %7s %10s %10s %10s\n", "Tier", "Calls", "Median ms", "p90 ms", "Escalated");
+    for (const auto &[key, entry] : entries) {
+        std::vector<double> samples(entry.samples_ms.begin(), entry.samples_ms.end());
+        double rate = entry.calls ? 100.0 * entry.rejected / entry.calls : 0.0;
+        std::printf("%-32s %7ld %10.0f %10.0f %9.1f%%\n", key.c_str(), entry.calls,
+                    percentile(samples, 0.5), percentile(samples, 0.9), rate);
+    }
+}
@@ -0,0 +1,140 @@
+#include "stringtable.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'S', 'Q', 'T', 'A', 'B', 'L', '1', '\0'};
+
+// File layout: header, two uint32 offsets (key, value) per entry into the
+// string blob, then the NUL-terminated strings.
+struct Header {
+    char magic[8];
+    uint64_t fingerprint;
+    uint64_t count;
+};
+
+} // namespace
+
+StringTable::StringTable(StringTable &&other) noexcept { *this = std::move(other); }
+
+StringTable &StringTable::operator=(StringTable &&other) noexcept {
+    if (this != &other) {
+        if (mapping) munmap(mapping, mappingSize);
+        mapping = other.mapping;
+        mappingSize = other.mappingSize;
+        count = other.count;
+        offsets = other.offsets;
+        blob = other.blob;
+        other.mapping = nullptr;
+        other.mappingSize = other.count = 0;
+        other.offsets = nullptr;
+        other.blob = nullptr;
+    }
+    return *this;
+}
+
+StringTable::~StringTable() {
+    if (mapping) munmap(mapping, mappingSize);
+}
+
+StringTable StringTable::map(const std::string &path, uint64_t fingerprint) {
+    StringTable table;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return table;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header) + 1) {
+        close(fd);
+        return table;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) return table;
+
+    const char *base = static_cast<const char *>(mapped);
+    const Header *header = reinterpret_cast<const Header *>(base);
+    size_t blobStart = sizeof(Header) + header->count * 2 * sizeof(uint32_t);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->fingerprint != fingerprint ||
+        header->count > size || blobStart >= size || base[size - 1] != '\0') {
+        munmap(mapped, size); // stale or foreign file
+        return table;
+    }
+    table.mapping = mapped;
+    table.mappingSize = size;
+    table.count = header->count;
+    table.offsets = reinterpret_cast<const uint32_t *>(base + sizeof(Header));
+    table.blob = base + blobStart;
+    return table;
+}
+
+bool StringTable::write(const std::string &path, uint64_t fingerprint,
+                        std::vector<std::pair<std::string, std::string>> entries) {
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    Header header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.fingerprint = fingerprint;
+    header.count = entries.size();
+    std::vector<uint32_t> offsets;
+    std::string blob(1, '\0'); // shared empty string, and never an empty blob
+    for (const auto &[key, value] : entries) {
+        for (const std::string *text : {&key, &value}) {
+            offsets.push_back(text->empty() ? 0 : static_cast<uint32_t>(blob.size()));
+            if (!text->empty()) blob.append(*text).push_back('\0');
+        }
+    }
+
+    // Write to a temporary file and rename, so a reader never maps half a file.
+    std::string temporary = path + ".tmp";
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(offsets.data()), offsets.size() * sizeof(uint32_t));
+    file.write(blob.data(), blob.size());
+    file.close();
+    if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        LOG_WARN("cannot write index", {"path", path});
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+size_t StringTable::lowerBound(std::string_view key) const {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (this->key(middle) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+uint64_t fingerprintFiles(const std::vector<std::string> &paths) {
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](const void *data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<const unsigned char *>(data)[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    for (const std::string &path : paths) {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) continue;
+        mix(path.data(), path.size());
+        mix(&info.st_size, sizeof(info.st_size));
+        mix(&info.st_mtim, sizeof(info.st_mtim));
+    }
+    return hash;
+}
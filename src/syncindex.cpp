@@ -0,0 +1,216 @@
+#include "syncindex.hpp"
+#include "dpkgstatus.hpp"
+#include "localdb.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <zlib.h>
+
+namespace Packages {
+
+namespace {
+
+// Bumped when the layout of the index file changes, so old files are rebuilt.
+const uint64_t kFormatVersion = 2;
+
+std::vector<std::string> defaultSources(const Config &config) {
+    std::string dir;
+    std::vector<std::string> suffixes;
+    if (config.package_manager.find("pacman") != std::string::npos) {
+        dir = "/var/lib/pacman/sync";
+        suffixes = {".db"};
+    } else if (config.package_manager.find("apt") != std::string::npos) {
+        dir = "/var/lib/apt/lists";
+        suffixes = {"_Packages", "_Packages.gz"};
+    }
+    std::vector<std::string> sources;
+    std::error_code error;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, error)) {
+        std::string name = entry.path().filename().string();
+        for (const std::string &suffix : suffixes) {
+            if (name.size() > suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                sources.push_back(entry.path().string());
+            }
+        }
+    }
+    std::sort(sources.begin(), sources.end());
+    return sources;
+}
+
+bool readFully(gzFile file, char *buffer, size_t size) {
+    while (size > 0) {
+        int n = gzread(file, buffer, static_cast<unsigned>(std::min<size_t>(size, 1 << 20)));
+        if (n <= 0) return false;
+        buffer += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// A pacman sync database is a (gzip) tar of <pkg>-<ver>/desc files, read
+// block by block as it is inflated.
+void addPacmanDb(gzFile file, std::vector<std::string> &names) {
+    char header[512];
+    std::string content;
+    while (readFully(file, header, sizeof(header))) {
+        if (header[0] == '\0') break; // end-of-archive marker
+        std::string path(header, strnlen(header, 100));
+        size_t size = std::strtoull(std::string(header + 124, strnlen(header + 124, 12)).c_str(), nullptr, 8);
+        size_t padded = (size + 511) / 512 * 512;
+        char type = header[156];
+        bool wanted = (type == '0' || type == '\0') && path.size() > 5 && path.compare(path.size() - 5, 5, "/desc") == 0;
+        content.resize(padded);
+        if (padded > 0 && !readFully(file, content.data(), padded)) break;
+        if (!wanted) continue;
+        content.resize(size);
+        LocalPackage package = parseDesc(content);
+        if (package.name.empty()) continue;
+        names.push_back(package.name);
+        names.insert(names.end(), package.provides.begin(), package.provides.end());
+    }
+}
+
+// apt's Packages lists: stanzas parsed a chunk at a time, carrying the
+// unfinished stanza over to the next chunk.
+void addAptList(gzFile file, std::vector<std::string> &names) {
+    std::string buffer;
+    std::vector<char> chunk(1 << 20);
+    auto take = [&names](const char *data, size_t size) {
+        DpkgStatus stanzas = parseDpkgStatus(data, size, false);
+        names.insert(names.end(), stanzas.installed.begin(), stanzas.installed.end());
+        names.insert(names.end(), stanzas.provides.begin(), stanzas.provides.end());
+    };
+    int n;
+    while ((n = gzread(file, chunk.data(), static_cast<unsigned>(chunk.size()))) > 0) {
+        buffer.append(chunk.data(), n);
+        size_t cut = buffer.rfind("\n\n");
+        if (cut == std::string::npos) continue;
+        take(buffer.data(), cut + 2);
+        buffer.erase(0, cut + 2);
+    }
+    take(buffer.data(), buffer.size());
+}
+
+// Canonical spelling for fuzzy comparison: lower case, '_' and '.' as '-'.
+std::string fold(std::string_view name) {
+    std::string folded(name);
+    for (char &c : folded) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (c == '_' || c == '.') c = '-';
+    }
+    return folded;
+}
+
+// Levenshtein distance, giving up as soon as it must exceed limit.
+int editDistance(std::string_view a, std::string_view b, int limit) {
+    std::vector<int> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) row[j] = static_cast<int>(j);
+    for (size_t i = 1; i <= a.size(); ++i) {
+        int diagonal = row[0];
+        row[0] = static_cast<int>(i);
+        int best = row[0];
+        for (size_t j = 1; j <= b.size(); ++j) {
+            int above = row[j];
+            row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+            diagonal = above;
+            best = std::min(best, row[j]);
+        }
+        if (best > limit) return limit + 1;
+    }
+    return row[b.size()];
+}
+
+} // namespace
+
+SyncIndex SyncIndex::open(const Config &config) {
+    std::vector<std::string> sources = defaultSources(config);
+    if (sources.empty()) return {};
+    return open(sources, cachePath("sync-index.bin"));
+}
+
+SyncIndex SyncIndex::open(const std::vector<std::string> &sources, const std::string &indexPath) {
+    SyncIndex index;
+    uint64_t fingerprint = fingerprintFiles(sources) ^ (kFormatVersion * 0x9E3779B97F4A7C15ull);
+    index.table = StringTable::map(indexPath, fingerprint);
+    if (!index.table.empty()) return index;
+
+    std::vector<std::string> names;
+    for (const std::string &source : sources) {
+        gzFile file = gzopen(source.c_str(), "rb"); // also reads uncompressed files
+        if (!file) continue;
+        gzbuffer(file, 1 << 17);
+        bool pacman = source.size() > 3 && source.compare(source.size() - 3, 3, ".db") == 0;
+        if (pacman) {
+            addPacmanDb(file, names);
+        } else {
+            addAptList(file, names);
+        }
+        gzclose(file);
+    }
+    std::vector<std::pair<std::string, std::string>> entries;
+    entries.reserve(names.size());
+    for (std::string &name : names) entries.emplace_back(fold(name), std::move(name));
+    if (StringTable::write(indexPath, fingerprint, std::move(entries))) {
+        index.table = StringTable::map(indexPath, fingerprint);
+    }
+    return index;
+}
+
+bool SyncIndex::contains(std::string_view name) const {
+    std::string folded = fold(name);
+    for (size_t position = table.lowerBound(folded); position < table.size() && table.key(position) == folded; ++position) {
+        if (table.value(position) == name) return true;
+    }
+    return false;
+}
+
+std::string SyncIndex::spelling(std::string_view name) const {
+    if (contains(name)) return std::string(name);
+    std::string folded = fold(name);
+    size_t position = table.lowerBound(folded);
+    return position < table.size() && table.key(position) == folded ? std::string(table.value(position)) : "";
+}
+
+const std::vector<std::vector<uint32_t>> &SyncIndex::byLength() const {
+    std::call_once(lengths->built, [this]() {
+        for (size_t i = 0; i < table.size(); ++i) {
+            size_t length = table.key(i).size();
+            if (lengths->entries.size() <= length) lengths->entries.resize(length + 1);
+            lengths->entries[length].push_back(static_cast<uint32_t>(i));
+        }
+    });
+    return lengths->entries;
+}
+
+std::string SyncIndex::closest(std::string_view name) const {
+    std::string exact = spelling(name);
+    if (!exact.empty()) return exact;
+    std::string folded = fold(name);
+    int maxDistance = folded.size() < 4 ? 0 : folded.size() < 8 ? 1 : 2;
+    if (maxDistance == 0) return "";
+
+    // An edit changes the length by at most one, so only keys within
+    // maxDistance of this length can be close enough.
+    const std::vector<std::vector<uint32_t>> &buckets = byLength();
+    std::string best;
+    int bestDistance = maxDistance + 1;
+    for (int gap = 0; gap <= maxDistance && gap < bestDistance; ++gap) {
+        for (int sign : {-1, 1}) {
+            if (gap == 0 && sign > 0) continue;
+            long length = static_cast<long>(folded.size()) + sign * gap;
+            if (length < 0 || length >= static_cast<long>(buckets.size())) continue;
+            for (uint32_t entry : buckets[length]) {
+                int distance = editDistance(folded, table.key(entry), bestDistance - 1);
+                if (distance < bestDistance) {
+                    best = std::string(table.value(entry));
+                    bestDistance = distance;
+                }
+            }
+        }
+    }
+    return bestDistance <= maxDistance ? best : "";
+}
+
+} // namespace Packages
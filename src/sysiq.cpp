@@ -0,0 +1,195 @@
+#include "sysiq.hpp"
+#include "ai.hpp"
+#include "commandindex.hpp"
+#include "executor.hpp"
+#include "http.hpp"
+#include "packages.hpp"
+#include "session.hpp"
+#include "syncindex.hpp"
+#include "systeminfo.hpp"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+namespace SysIQ {
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// Everything a query needs, shared with the jobs in flight. The indexes are
+// loaded by whichever job gets to them first; the others wait for that load
+// rather than queueing a second one, so a single-threaded schedule cannot
+// deadlock.
+struct Client::State {
+    State(Config config, std::string apiKey) : config(std::move(config)), apiKey(std::move(apiKey)) {}
+
+    const Config config;
+    const std::string apiKey;
+    Executor probes{2}; // context probes and status checks; leaf jobs only
+
+    const Packages::InstalledSet &installed() {
+        std::call_once(installedOnce, [this]() { installedSet = Packages::loadInstalled(config); });
+        return installedSet;
+    }
+
+    const Packages::CommandIndex &commands() {
+        std::call_once(commandsOnce, [this]() { commandIndex.emplace(Packages::CommandIndex::open(config)); });
+        return *commandIndex;
+    }
+
+    const Packages::SyncIndex &sync() {
+        std::call_once(syncOnce, [this]() { syncIndex.emplace(Packages::SyncIndex::open(config)); });
+        return *syncIndex;
+    }
+
+    Result run(const std::string &userQuery, const QueryOptions &options);
+
+private:
+    std::once_flag installedOnce, commandsOnce, syncOnce;
+    Packages::InstalledSet installedSet;
+    std::optional<Packages::CommandIndex> commandIndex;
+    std::optional<Packages::SyncIndex> syncIndex;
+};
+
+Result Client::State::run(const std::string &userQuery, const QueryOptions &options) {
+    Result result;
+    result.query = userQuery;
+    Http::CancelScope scope(options.cancel.state());
+    auto cancelled = [&]() {
+        if (!options.cancel.cancelled()) return false;
+        result.error = "cancelled";
+        return true;
+    };
+    if (cancelled()) return result;
+
+    // Only the probes this query can use; a session answers from its history.
+    auto start = std::chrono::steady_clock::now();
+    nlohmann::json context = options.session.empty() ? gatherContext(config, userQuery, probes) : nlohmann::json::object();
+    result.context_ms = elapsedMs(start);
+    if (cancelled()) return result;
+
+    start = std::chrono::steady_clock::now();
+    AI::PackageValidator validator = [this](const std::string &name) {
+        return Packages::exists(name, config, installed(), sync());
+    };
+    AI::PackageListResponse response;
+    if (!options.session.empty()) {
+        AI::Session session = AI::Session::load(options.session);
+        response = AI::querySession(config, session, userQuery, apiKey, validator);
+    } else {
+        response = AI::queryPackageList(config, context, userQuery, apiKey, validator);
+    }
+    result.query_ms = elapsedMs(start);
+    if (cancelled()) return result;
+    if (response.packages.empty()) {
+        result.error = "no usable package list";
+        return result;
+    }
+
+    // Misspelled names are corrected against the repositories, and a command
+    // an installed package already ships settles the status without asking
+    // the package manager (or shows the suggestion names the wrong package).
+    start = std::chrono::steady_clock::now();
+    std::vector<std::future<bool>> status;
+    for (const AI::PackageInfo &package : response.packages) {
+        Suggestion suggestion;
+        suggestion.command = package.command;
+        suggestion.package_name = Packages::resolve(package.package_name, config, installed(), sync());
+        suggestion.known = !suggestion.package_name.empty();
+        if (!suggestion.known) {
+            suggestion.package_name = package.package_name;
+        } else if (suggestion.package_name != package.package_name) {
+            suggestion.suggested_name = package.package_name;
+        }
+        std::vector<std::string> owners = commands().owners(Packages::commandProgram(package.command));
+        bool ships = std::find(owners.begin(), owners.end(), suggestion.package_name) != owners.end();
+        if (!ships && !owners.empty()) suggestion.provided_by = owners.front();
+        status.push_back(probes.submit([this, ships, name = suggestion.package_name]() {
+            return ships || Packages::isInstalled(name, config, installed());
+        }));
+        result.suggestions.push_back(suggestion);
+    }
+    for (size_t i = 0; i < status.size(); ++i) result.suggestions[i].installed = status[i].get();
+    result.resolve_ms = elapsedMs(start);
+    return result;
+}
+
+nlohmann::json toJson(const Result &result) {
+    nlohmann::json packages = nlohmann::json::array();
+    for (const Suggestion &suggestion : result.suggestions) {
+        nlohmann::json entry = {{"package_name", suggestion.package_name}, {"command", suggestion.command},
+                                {"installed", suggestion.installed}, {"known", suggestion.known}};
+        if (!suggestion.suggested_name.empty()) entry["suggested_name"] = suggestion.suggested_name;
+        if (!suggestion.provided_by.empty()) entry["provided_by"] = suggestion.provided_by;
+        packages.push_back(entry);
+    }
+    nlohmann::json document = {{"query", result.query}, {"packages", packages},
+                               {"timings_ms", {{"context", result.context_ms}, {"query", result.query_ms}, {"resolve", result.resolve_ms}}}};
+    if (!result.error.empty()) document["error"] = result.error;
+    return document;
+}
+
+Schedule scheduleOn(Executor &executor) {
+    return [&executor](std::function<void()> job) { executor.submit(std::move(job)); };
+}
+
+Client::Client(Config config, std::string apiKey, Schedule schedule)
+    : state(std::make_shared<State>(std::move(config), std::move(apiKey))) {
+    if (!schedule) {
+        pool = std::make_unique<Executor>(kWarmupJobs + 1);
+        schedule = scheduleOn(*pool);
+    }
+    this->schedule = std::move(schedule);
+
+    // Warm up alongside the first query: the connection and the indexes.
+    std::shared_ptr<State> shared = state;
+    this->schedule([shared]() { AI::preconnect(shared->config); });
+    this->schedule([shared]() { shared->installed(); });
+    this->schedule([shared]() { shared->commands(); });
+    this->schedule([shared]() { shared->sync(); });
+}
+
+Client::~Client() = default;
+
+void Client::query(const std::string &userQuery, std::function<void(Result)> done, QueryOptions options) {
+    std::shared_ptr<State> shared = state;
+    schedule([shared, userQuery, done = std::move(done), options = std::move(options)]() {
+        Result result;
+        try {
+            result = shared->run(userQuery, options);
+        } catch (const std::exception &e) {
+            result.query = userQuery;
+            result.error = e.what();
+        }
+        done(std::move(result));
+    });
+}
+
+std::future<Result> Client::query(const std::string &userQuery, QueryOptions options) {
+    auto promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> result = promise->get_future();
+    query(userQuery, [promise](Result answer) { promise->set_value(std::move(answer)); }, std::move(options));
+    return result;
+}
+
+std::future<bool> Client::isInstalled(const std::string &package) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> result = promise->get_future();
+    std::shared_ptr<State> shared = state;
+    schedule([shared, promise, package]() {
+        promise->set_value(Packages::isInstalled(package, shared->config, shared->installed()));
+    });
+    return result;
+}
+
+const Config &Client::config() const {
+    return state->config;
+}
+
+} // namespace SysIQ
@@ -1,36 +1,113 @@
 #include "systeminfo.hpp"
 #include "utils.hpp"
+#include "display.hpp"
+#include "localdb.hpp"
+#include "dpkgstatus.hpp"
+#include <algorithm>
+#include <cctype>
+#include <future>
 #include <sstream>
 #include <iostream>
+#include <sys/utsname.h>
 
-json getSystemInfo(const Config &config) {
-    json info;
-    info["kernel"] = runCommand("uname -r");
-    info["uptime"] = runCommand("uptime -p");
+namespace {
+
+json kernelProbe(const Config &) {
+    struct utsname name;
+    if (uname(&name) != 0) return "Unknown";
+    return std::string(name.release) + " " + name.machine;
+}
 
-    // Instead of hardcoding package commands, we let AI determine it.
-    // But as a fallback, if distro contains "Arch", we use pacman.
+json uptimeProbe(const Config &) {
+    return runCommand("uptime -p");
+}
+
+json packagesProbe(const Config &config) {
+    // Count straight from the package databases rather than through the
+    // package manager, which for apt means loading its whole cache.
     if (config.distro.find("Arch") != std::string::npos) {
-        info["packages"] = runCommand("pacman -Qq | wc -l");
-    } else if (config.distro.find("Ubuntu") != std::string::npos) {
-        info["packages"] = runCommand("apt list --installed 2>/dev/null | wc -l");
-    } else {
-        // For other distros, leave it empty. The AI can help decide later.
-        info["packages"] = "Unknown";
+        return Packages::LocalIndex::load().packages.size();
     }
+    Packages::DpkgStatus status = Packages::loadDpkgStatus();
+    if (!status.installed.empty()) return status.installed.size();
+    // For other distros, leave it empty. The AI can help decide later.
+    return "Unknown";
+}
 
+json shellProbe(const Config &config) {
     // Get shell version based on the configured shell.
-    info["shell_version"] = checkDependency(config.shell) ? runCommand(config.shell + " --version") : "Unknown";
-
-    // Get monitor info (if xrandr exists)
-    if (checkDependency("xrandr")) {
-        std::string xrandrOut = runCommand("xrandr --query");
-        std::istringstream iss(xrandrOut);
-        std::string firstLine;
-        std::getline(iss, firstLine);
-        info["monitor"] = firstLine;
-    } else {
-        info["monitor"] = "xrandr not installed";
+    return checkDependency(config.shell) ? runCommand(config.shell + " --version") : "Unknown";
+}
+
+json monitorProbe(const Config &) {
+    // Monitor info straight from DRM sysfs + EDID; works on X11, Wayland and the console.
+    json monitors = json::array();
+    for (const MonitorInfo &monitor : probeMonitors()) {
+        monitors.push_back(toJson(monitor));
+    }
+    return monitors;
+}
+
+std::vector<std::string> words(const std::string &query) {
+    std::vector<std::string> result;
+    std::string word;
+    for (char c : query + " ") {
+        if (std::isalnum(static_cast<unsigned char>(c))) {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        } else if (!word.empty()) {
+            result.push_back(word);
+            word.clear();
+        }
+    }
+    return result;
+}
+
+bool relevant(const ContextProbe &probe, const std::vector<std::string> &queryWords) {
+    if (probe.keywords.empty()) return true;
+    for (const std::string &word : queryWords) {
+        for (const std::string &keyword : probe.keywords) {
+            // Prefix match so "monitors" or "installing" still count.
+            if (word.compare(0, keyword.size(), keyword) == 0) return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const std::vector<ContextProbe> &contextProbes() {
+    static const std::vector<ContextProbe> probes = {
+        {"kernel", 0, {}, kernelProbe},
+        {"uptime", 2, {"uptime", "boot", "reboot", "running"}, uptimeProbe},
+        {"packages", 300, {"install", "package", "update", "upgrade", "remove", "uninstall", "orphan", "dependenc"}, packagesProbe},
+        {"shell_version", 10, {"shell", "bash", "zsh", "fish", "script", "alias", "prompt", "completion", "history"}, shellProbe},
+        {"monitor", 1, {"monitor", "display", "screen", "resolution", "refresh", "hdmi", "edid", "brightness", "hz", "dpi"}, monitorProbe},
+    };
+    return probes;
+}
+
+json gatherContext(const Config &config, const std::string &query, Executor &executor) {
+    std::vector<std::string> queryWords = words(query);
+    std::vector<std::pair<std::string, std::future<json>>> running;
+    json context = json::object();
+    for (const ContextProbe &probe : contextProbes()) {
+        if (!relevant(probe, queryWords)) continue;
+        if (probe.cost_ms == 0) {
+            context[probe.name] = probe.run(config); // Not worth a thread hop.
+        } else {
+            running.emplace_back(probe.name, executor.submit([&probe, &config]() { return probe.run(config); }));
+        }
+    }
+    for (auto &[name, result] : running) {
+        context[name] = result.get();
+    }
+    return context;
+}
+
+json getSystemInfo(const Config &config) {
+    json info;
+    for (const ContextProbe &probe : contextProbes()) {
+        info[probe.name] = probe.run(config);
     }
     return info;
 }
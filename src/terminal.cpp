@@ -0,0 +1,200 @@
+#include "terminal.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <iostream>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+namespace Terminal {
+
+namespace {
+
+// Bytes of a cursor jump ("\x1b[42G"); shorter unchanged runs are resent.
+const size_t kJumpCost = 5;
+
+void writeOut(const std::string &text) {
+    std::cout.flush(); // keep ordering with anything still buffered
+    const char *data = text.data();
+    size_t size = text.size();
+    while (size > 0) {
+        ssize_t n = ::write(STDOUT_FILENO, data, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+}
+
+std::string sgr(Color color, bool bold) {
+    std::string code = "\x1b[0";
+    if (bold) code += ";1";
+    if (color == Color::Green) code += ";32";
+    if (color == Color::Yellow) code += ";33";
+    if (color == Color::Red) code += ";31";
+    return code + "m";
+}
+
+// Splits spans into one cell per code point, dropping control characters,
+// up to width cells.
+std::vector<Renderer::Cell> layout(const Line &line, int width) {
+    std::vector<Renderer::Cell> cells;
+    for (const Span &span : line) {
+        for (size_t i = 0; i < span.text.size() && static_cast<int>(cells.size()) < width;) {
+            unsigned char lead = static_cast<unsigned char>(span.text[i]);
+            size_t length = lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+            if (lead >= 0x20 && lead != 0x7F) cells.push_back({span.text.substr(i, length), span.color, span.bold});
+            i += length;
+        }
+    }
+    return cells;
+}
+
+} // namespace
+
+bool isTty() {
+    static const bool tty = isatty(STDOUT_FILENO);
+    return tty;
+}
+
+int width() {
+    struct winsize size = {};
+    if (isTty() && ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) return size.ws_col;
+    const char *columns = std::getenv("COLUMNS");
+    int fromEnvironment = columns ? std::atoi(columns) : 0;
+    return fromEnvironment > 0 ? fromEnvironment : 80;
+}
+
+const char *style(const char *code) { return isTty() ? code : ""; }
+
+Line progressBar(double fraction, const std::string &message) {
+    fraction = std::clamp(fraction, 0.0, 1.0);
+    std::string percent = std::to_string(static_cast<int>(fraction * 100.0)) + "%";
+    percent.insert(0, 5 - percent.size(), ' '); // fixed width, so the bar doesn't shift
+    // "message [" + bar + "]" + percent, at most 50 cells of bar.
+    int barWidth = std::min(50, width() - 1 - static_cast<int>(message.size() + 3 + percent.size()));
+    if (barWidth < 10) return {{message + percent, Color::Yellow}};
+    int filled = static_cast<int>(barWidth * fraction);
+    return {
+        {message + " [", Color::Yellow},
+        {std::string(filled, '='), Color::Green},
+        {std::string(barWidth - filled, ' ')},
+        {"]", Color::Yellow},
+        {percent},
+    };
+}
+
+void Renderer::moveTo(size_t row, std::string &out) {
+    if (rows == 0) rows = 1; // the block starts on the cursor's line
+    if (row < cursorRow) {
+        out += "\x1b[" + std::to_string(cursorRow - row) + "A";
+    } else if (row > cursorRow) {
+        size_t existing = std::min(row, rows - 1);
+        if (existing > cursorRow) out += "\x1b[" + std::to_string(existing - cursorRow) + "B";
+        // Rows below the block are made with newlines, which scroll if needed.
+        for (size_t next = existing; next < row; ++next) out += "\r\n";
+        rows = std::max(rows, row + 1);
+    }
+    cursorRow = row;
+}
+
+void Renderer::draw(const std::vector<Line> &lines) {
+    int columns = width();
+    std::vector<std::vector<Cell>> frame;
+    for (const Line &line : lines) frame.push_back(layout(line, columns - 1));
+    if (!isTty()) {
+        previous = std::move(frame);
+        return;
+    }
+
+    std::string out;
+    if (columns != lastWidth && rows > 0) {
+        // The terminal was resized and old lines may have rewrapped: redraw all.
+        moveTo(0, out);
+        out += "\r\x1b[J";
+        previous.clear();
+    }
+    for (size_t row = 0; row < frame.size(); ++row) {
+        const std::vector<Cell> &line = frame[row];
+        const std::vector<Cell> *old = row < previous.size() ? &previous[row] : nullptr;
+        size_t first = 0, end = line.size();
+        if (old) {
+            while (first < line.size() && first < old->size() && line[first] == (*old)[first]) ++first;
+            if (first == line.size() && first == old->size()) continue; // unchanged
+            // Same length: the unchanged tail (a bar's "] 42%") can stay too.
+            if (old->size() == line.size()) {
+                while (end > first && line[end - 1] == (*old)[end - 1]) --end;
+            }
+        }
+        moveTo(row, out);
+        Color color = Color::Default;
+        bool bold = false;
+        bool styled = false;
+        for (size_t i = first; i < end;) {
+            // Jump over unchanged stretches too long to be worth resending.
+            if (old && i > first && i < old->size() && line[i] == (*old)[i]) {
+                size_t next = i;
+                while (next < end && next < old->size() && line[next] == (*old)[next]) ++next;
+                if (next - i > kJumpCost) {
+                    i = next;
+                    out += "\x1b[" + std::to_string(i + 1) + "G";
+                    continue;
+                }
+            }
+            if (i == first) out += "\x1b[" + std::to_string(first + 1) + "G";
+            if (!styled || line[i].color != color || line[i].bold != bold) {
+                color = line[i].color;
+                bold = line[i].bold;
+                out += sgr(color, bold);
+                styled = true;
+            }
+            out += line[i].glyph;
+            ++i;
+        }
+        if (styled) out += "\x1b[0m";
+        if (old && old->size() > line.size()) {
+            // Only shortened (the new line is a prefix of the old): nothing above
+            // moved the cursor to where the erase starts.
+            if (first == end) out += "\x1b[" + std::to_string(first + 1) + "G";
+            out += "\x1b[K";
+        }
+    }
+    for (size_t row = frame.size(); row < previous.size(); ++row) {
+        moveTo(row, out);
+        out += "\r\x1b[2K";
+    }
+    if (!out.empty()) writeOut(out);
+    previous = std::move(frame);
+    lastWidth = columns;
+}
+
+void Renderer::finish() {
+    if (!isTty()) {
+        std::string out;
+        for (const std::vector<Cell> &line : previous) {
+            for (const Cell &cell : line) out += cell.glyph;
+            out += "\n";
+        }
+        if (!out.empty()) writeOut(out);
+    } else if (rows > 0) {
+        std::string out;
+        moveTo(previous.empty() ? 0 : previous.size() - 1, out);
+        writeOut(out + "\r\n");
+    }
+    previous.clear();
+    rows = cursorRow = 0;
+    lastWidth = 0;
+}
+
+void Renderer::erase() {
+    if (isTty() && rows > 0) {
+        std::string out;
+        moveTo(0, out);
+        writeOut(out + "\r\x1b[J");
+    }
+    previous.clear();
+    rows = cursorRow = 0;
+    lastWidth = 0;
+}
+
+} // namespace Terminal
@@ -2,6 +2,10 @@
 #include <cstdio>
 #include <array>
 #include <algorithm> // Required for std::remove
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <unistd.h>
 
 std::string runCommand(const std::string &command) {
     std::array<char, 256> buffer;
@@ -23,4 +27,32 @@ std::string runCommand(const std::string &command) {
 bool checkDependency(const std::string &cmd) {
     std::string result = runCommand("which " + cmd);
     return !result.empty();
-}
\ No newline at end of file
+}
+
+std::string readFile(const std::string &path) {
+    std::string result;
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return result;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+        result.append(buffer, n);
+    }
+    close(fd);
+    return result;
+}
+
+std::string cachePath(const std::string &name) {
+    std::filesystem::path dir;
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        dir = xdg;
+    } else if (const char *home = std::getenv("HOME"); home && *home) {
+        dir = std::filesystem::path(home) / ".cache";
+    } else {
+        dir = "/tmp";
+    }
+    dir /= "sysiq";
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    return (dir / name).string();
+}
@@ -0,0 +1,64 @@
+// Table-driven checks for the progress parser that turns pacman output and
+// apt's Status-Fd lines into the install progress bar.
+#include "install.hpp"
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+struct Case {
+    const char *line;
+    bool parsed;
+    const char *stage;  // when parsed
+    double fraction;    // when parsed
+};
+
+const Case kCases[] = {
+    // apt (APT::Status-Fd): downloads fill the first half, dpkg the second.
+    {"dlstatus:1:0:Retrieving file 1 of 3", true, "downloading", 0.0},
+    {"dlstatus:2:50:Retrieving file 2 of 3", true, "downloading", 0.25},
+    {"dlstatus:3:100:Retrieving file 3 of 3", true, "downloading", 0.5},
+    {"pmstatus:htop:0:Preparing to unpack htop", true, "installing", 0.5},
+    {"pmstatus:htop:50:Unpacking htop (3.2.2-2)", true, "installing", 0.75},
+    {"pmstatus:dpkg-exec:100:Running dpkg", true, "installing", 1.0},
+    {"pmstatus:htop:250:Out of range", true, "installing", 1.0},
+    {"pmstatus:htop", false, "", 0},
+    {"dlstatus:1", false, "", 0},
+
+    // pacman: "(i/n) stage ... NN%", with downloads, checks and installation
+    // mapped onto successive parts of the bar.
+    {"(1/1) installing htop                     [######################] 100%", true, "installing", 1.0},
+    {"(2/3) installing htop                     [###########-----------]  50%", true, "installing", 0.6 + 0.4 * 1.5 / 3},
+    {"(1/2) checking keys in keyring            [###########-----------]  50%", true, "checking", 0.5 + 0.1 * 0.5 / 2},
+    {"( 2/2) loading package files              [######################] 100%", true, "loading", 0.6},
+    {"(1/2) upgrading linux                     [----------------------]   0%", true, "upgrading", 0.6},
+    {"Total ( 1/2)         1.2 MiB  2.40 MiB/s 00:00 [#######--------------]  40%", true, "downloading", 0.5 * 0.4 / 2},
+    {" htop-3.2.2-1-x86_64    178.6 KiB  1.2 MiB/s 00:00 [###########] 100%", true, "downloading", 0.5},
+    {"\x1b[1m(1/1) installing htop [#####] 100%\x1b[0m", true, "installing", 1.0},
+
+    // Lines without progress go to the output tail instead.
+    {"resolving dependencies...", false, "", 0},
+    {":: Proceed with installation? [Y/n]", false, "", 0},
+    {"Reading package lists... Done", false, "", 0},
+    {"(3/2) installing htop [###] 50%", false, "", 0},
+    {"", false, "", 0},
+};
+
+} // namespace
+
+int main() {
+    int failures = 0;
+    for (const Case &test : kCases) {
+        Packages::InstallProgress progress;
+        bool parsed = Packages::parseInstallProgress(test.line, progress);
+        bool ok = parsed == test.parsed &&
+                  (!parsed || (progress.stage == test.stage && std::fabs(progress.fraction - test.fraction) < 1e-9));
+        if (!ok) {
+            std::cerr << "FAIL parseInstallProgress(\"" << test.line << "\") = " << parsed << " \"" << progress.stage << "\" "
+                      << progress.fraction << ", expected " << test.parsed << " \"" << test.stage << "\" " << test.fraction << "\n";
+            ++failures;
+        }
+    }
+    std::cout << (sizeof(kCases) / sizeof(kCases[0]) - failures) << "/" << sizeof(kCases) / sizeof(kCases[0]) << " install progress checks passed\n";
+    return failures == 0 ? 0 : 1;
+}
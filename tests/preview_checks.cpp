@@ -0,0 +1,98 @@
+// Table-driven checks for the read-only classifier that decides which
+// suggestions may run ahead of time in the preview sandbox.
+#include "preview.hpp"
+#include <iostream>
+
+namespace {
+
+struct Case {
+    const char *command;
+    bool readOnly;
+};
+
+const Case kCases[] = {
+    // Plain informational commands, pipelines and chains.
+    {"ls -la /etc", true},
+    {"df -h", true},
+    {"lsblk -f", true},
+    {"ip a", true},
+    {"ip -br link | grep UP", true},
+    {"ps aux | sort -k3 -r | head", true},
+    {"uname -a && lsb_release -a", true},
+    {"LANG=C free -h", true},
+    {"journalctl -b -p err 2>/dev/null | tail -n 50", true},
+    {"find / -name '*.conf' -type f", true},
+    {"date +%s", true},
+    {"systemctl status sshd", true},
+    {"resolvectl status", true},
+    {"resolvectl dns", true},
+    {"resolvectl dns eth0", true},
+    {"nmcli device status", true},
+    {"pacman -Qi htop", true},
+    {"apt-cache policy vim", true},
+    {"dpkg -L coreutils", true},
+
+    // Unknown programs, writes, substitutions and background jobs.
+    {"rm -rf /tmp/x", false},
+    {"sudo lsblk", false},
+    {"ls > files.txt", false},
+    {"echo $(id)", false},
+    {"cat `which ls`", false},
+    {"diff <(ls a) <(ls b)", false},
+    {"sleep 10 &", false},
+    {"ls\nrm x", false},
+
+    // Forbidden options, including bundled short options and attached values.
+    {"sort -o out.txt in.txt", false},
+    {"sort -oout.txt in.txt", false},
+    {"sort -ro out.txt in.txt", false},
+    {"sort --output=out.txt in.txt", false},
+    {"sort -r in.txt", true},
+    {"find . -delete", false},
+    {"find . -exec rm {} ;", false},
+    {"find . -fprint list.txt", false},
+    {"find . -fprint0 list.txt", false},
+    {"find . -fprintf list.txt %p", false},
+    {"dmesg -c", false},
+    {"dmesg -Tc", false},
+    {"dmesg -T", true},
+    {"date -s 2020-01-01", false},
+    {"date 0101000020", false},
+    {"journalctl --vacuum-size=100M", false},
+    {"xrandr --output HDMI-1 --off", false},
+
+    // Subcommand whitelists.
+    {"ip link set eth0 down", false},
+    {"ip route add default via 10.0.0.1", false},
+    {"ip addr flush dev eth0", false},
+    {"systemctl restart sshd", false},
+    {"systemctl", false},
+    {"resolvectl dns eth0 1.1.1.1", false},
+    {"resolvectl domain eth0 example.com", false},
+    {"resolvectl flush-caches", false},
+    {"nmcli general hostname foo", false},
+    {"nmcli general logging level DEBUG", false},
+    {"nmcli radio wifi off", false},
+    {"nmcli connection up home", false},
+    {"pacman -S htop", false},
+    {"pacman -Syu", false},
+    {"apt install vim", false},
+    {"dpkg -i package.deb", false},
+    {"gsettings set org.gnome.desktop.interface clock-format 24h", false},
+    {"bluetoothctl power off", false},
+};
+
+} // namespace
+
+int main() {
+    int failures = 0;
+    for (const Case &test : kCases) {
+        bool readOnly = Preview::isReadOnly(test.command);
+        if (readOnly != test.readOnly) {
+            std::cerr << "FAIL isReadOnly(\"" << test.command << "\") = " << readOnly << ", expected " << test.readOnly << "\n";
+            ++failures;
+        }
+    }
+    std::cout << (sizeof(kCases) / sizeof(kCases[0]) - failures) << "/" << sizeof(kCases) / sizeof(kCases[0]) << " preview checks passed\n";
+    return failures == 0 ? 0 : 1;
+}